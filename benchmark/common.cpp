@@ -0,0 +1,124 @@
+#include "common.hpp"
+
+#include "jsonL.hpp"
+
+#include <malloc.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <new>
+#include <sstream>
+
+namespace {
+
+std::atomic<int> g_trackers{0};
+std::atomic<int64_t> g_allocs{0};
+std::atomic<int64_t> g_bytes{0};
+std::atomic<int64_t> g_live{0};
+std::atomic<int64_t> g_peak{0};
+
+void *track_alloc(size_t size) {
+  void *p = std::malloc(size ? size : 1);
+  if (!p) throw std::bad_alloc();
+  if (g_trackers.load(std::memory_order_relaxed) > 0) {
+    int64_t usable = int64_t(malloc_usable_size(p));
+    g_allocs.fetch_add(1, std::memory_order_relaxed);
+    g_bytes.fetch_add(usable, std::memory_order_relaxed);
+    int64_t live = g_live.fetch_add(usable, std::memory_order_relaxed) + usable;
+    int64_t peak = g_peak.load(std::memory_order_relaxed);
+    while (live > peak &&
+           !g_peak.compare_exchange_weak(peak, live, std::memory_order_relaxed)) {
+    }
+  }
+  return p;
+}
+
+void track_free(void *p) {
+  if (!p) return;
+  if (g_trackers.load(std::memory_order_relaxed) > 0) {
+    g_live.fetch_sub(int64_t(malloc_usable_size(p)), std::memory_order_relaxed);
+  }
+  std::free(p);
+}
+
+}  // namespace
+
+void *operator new(size_t size) { return track_alloc(size); }
+void *operator new[](size_t size) { return track_alloc(size); }
+void operator delete(void *p) noexcept { track_free(p); }
+void operator delete[](void *p) noexcept { track_free(p); }
+void operator delete(void *p, size_t) noexcept { track_free(p); }
+void operator delete[](void *p, size_t) noexcept { track_free(p); }
+
+namespace bench {
+
+std::string testdata_dir() {
+  const char *env = std::getenv("JSONL_TESTDATA");
+  if (env && *env) return env;
+  return JSONL_TESTDATA_DIR;
+}
+
+std::string read_file(const std::string &path) {
+  std::ifstream ifs(path, std::ios::binary);
+  std::stringstream ss;
+  ss << ifs.rdbuf();
+  return ss.str();
+}
+
+std::vector<Document> load_corpus(const std::string &dir) {
+  std::vector<Document> docs;
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator(dir, ec)) {
+    if (!entry.is_regular_file() || entry.path().extension() != ".json") {
+      continue;
+    }
+    Document doc;
+    doc.name = entry.path().stem().string();
+    doc.path = entry.path().string();
+    doc.json = read_file(doc.path);
+    docs.push_back(std::move(doc));
+  }
+  std::sort(docs.begin(), docs.end(),
+            [](const Document &a, const Document &b) { return a.name < b.name; });
+  return docs;
+}
+
+void add_kernel_context() {
+  benchmark::AddCustomContext("jsonL_kernel",
+                              jsonL::Json::kernel_name(jsonL::Json::kernel()));
+}
+
+AllocTracker::AllocTracker() {
+  // live bytes only count allocations made while tracking
+  if (g_trackers.fetch_add(1) == 0) {
+    g_live.store(0);
+  }
+  m_live = g_live.load();
+  g_peak.store(m_live);
+  m_allocs = g_allocs.load();
+  m_bytes = g_bytes.load();
+}
+
+AllocTracker::~AllocTracker() { g_trackers.fetch_sub(1); }
+
+AllocStats AllocTracker::stats() const {
+  AllocStats stats;
+  stats.allocs = g_allocs.load() - m_allocs;
+  stats.bytes = g_bytes.load() - m_bytes;
+  stats.peak_bytes = std::max<int64_t>(0, g_peak.load() - m_live);
+  return stats;
+}
+
+void AllocTracker::report(benchmark::State &state) const {
+  AllocStats s = stats();
+  state.counters["allocs/doc"] =
+      benchmark::Counter(double(s.allocs), benchmark::Counter::kAvgIterations);
+  state.counters["peak_bytes"] = benchmark::Counter(
+      double(s.peak_bytes), benchmark::Counter::kDefaults,
+      benchmark::Counter::kIs1024);
+}
+
+}  // namespace bench
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <benchmark/benchmark.h>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace bench {
+
+// Input file loaded into memory
+struct Document {
+  std::string name;
+  std::string path;
+  std::string json;
+};
+
+// Directory holding the testdata corpus, overridable with $JSONL_TESTDATA
+std::string testdata_dir();
+
+std::string read_file(const std::string &path);
+
+// Every *.json file directly under dir, sorted by name
+std::vector<Document> load_corpus(const std::string &dir);
+
+// Record the active jsonL kernel (forced with $JSONL_KERNEL) in the
+// benchmark context so results from different kernels stay apart
+void add_kernel_context();
+
+// Heap accounting through the replaced global operator new/delete.
+// Counting only happens while a tracker is alive on some thread.
+struct AllocStats {
+  int64_t allocs;
+  int64_t bytes;
+  int64_t peak_bytes;
+};
+
+class AllocTracker {
+ public:
+  AllocTracker();
+  ~AllocTracker();
+
+  // allocations and peak live bytes since construction
+  AllocStats stats() const;
+
+  // report allocs/doc and peak_bytes counters on state
+  void report(benchmark::State &state) const;
+
+ private:
+  int64_t m_allocs;
+  int64_t m_bytes;
+  int64_t m_live;
+};
+
+}  // namespace bench
@@ -0,0 +1,59 @@
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "jsonL.hpp"
+
+// Side by side view of two --benchmark_out=FILE json reports, e.g. the
+// plain and the PGO build of the same benchmark binary
+//   compare base.json pgo.json
+
+struct Timing {
+  double cpu_time = 0;
+  std::string unit;
+};
+
+static bool load(const char *path, std::vector<std::string> &order,
+                 std::map<std::string, Timing> &timings) {
+  std::string err;
+  jsonL::Json report = jsonL::Json::parse_from_file(path, err);
+  if (!err.empty()) {
+    std::cerr << "compare: " << path << ": " << err << std::endl;
+    return false;
+  }
+  for (const jsonL::Json &run : report["benchmarks"].array_items()) {
+    const std::string &name = run["name"].string_value();
+    if (!timings.count(name)) order.push_back(name);
+    Timing &timing = timings[name];
+    timing.cpu_time = run["cpu_time"].number_value();
+    timing.unit = run["time_unit"].string_value();
+  }
+  return true;
+}
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    std::cerr << "usage: compare base.json other.json" << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> order, other_order;
+  std::map<std::string, Timing> base, other;
+  if (!load(argv[1], order, base) || !load(argv[2], other_order, other)) {
+    return 1;
+  }
+
+  std::printf("%-40s %14s %14s %8s\n", "benchmark", "base", "other", "speedup");
+  for (const std::string &name : order) {
+    auto found = other.find(name);
+    if (found == other.end()) continue;
+    const Timing &a = base[name];
+    const Timing &b = found->second;
+    std::printf("%-40s %11.0f %-2s %11.0f %-2s %7.2fx\n", name.c_str(),
+                a.cpu_time, a.unit.c_str(), b.cpu_time, b.unit.c_str(),
+                b.cpu_time > 0 ? a.cpu_time / b.cpu_time : 0.0);
+  }
+  return 0;
+}
@@ -0,0 +1,139 @@
+#include "generator.hpp"
+
+#include <algorithm>
+#include <cstdio>
+
+namespace bench {
+
+Generator::Generator(const GeneratorOptions &options)
+    : m_options(options), m_state(options.seed) {
+  if (m_options.depth < 1) m_options.depth = 1;
+  if (m_options.width < 1) m_options.width = 1;
+  if (m_options.key_cardinality < 1) m_options.key_cardinality = 1;
+}
+
+// splitmix64, std distributions differ between standard libraries
+uint64_t Generator::next() {
+  uint64_t z = (m_state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+double Generator::uniform() { return double(next() >> 11) * (1.0 / 9007199254740992.0); }
+
+uint64_t Generator::below(uint64_t n) { return next() % n; }
+
+void Generator::record(std::string &out) { object(out, 1, m_options.depth, true); }
+
+// containers below level limit may nest further
+void Generator::value(std::string &out, int level, int limit) {
+  if (level < limit && uniform() < 0.3) {
+    if (next() & 1) {
+      object(out, level + 1, limit, false);
+    } else {
+      array(out, level + 1, limit);
+    }
+  } else {
+    scalar(out);
+  }
+}
+
+// a chain object's first member goes one level deeper, so every record
+// reaches options.depth; side branches add at most two levels, which keeps
+// record size linear in depth
+void Generator::object(std::string &out, int level, int limit, bool chain) {
+  int width = int(below(uint64_t(m_options.width))) + 1;
+  int side_limit = chain ? std::min(m_options.depth, level + 2) : limit;
+  // consecutive key ids keep the members of one object distinct
+  uint32_t key = uint32_t(below(m_options.key_cardinality));
+  out += '{';
+  for (int i = 0; i < width; i++) {
+    if (i) out += ',';
+    char buf[24];
+    snprintf(buf, sizeof buf, "\"k%u\":", (key + uint32_t(i)) % m_options.key_cardinality);
+    out += buf;
+    if (chain && i == 0 && level < m_options.depth) {
+      object(out, level + 1, limit, true);
+    } else {
+      value(out, level, side_limit);
+    }
+  }
+  out += '}';
+}
+
+void Generator::array(std::string &out, int level, int limit) {
+  int width = int(below(uint64_t(m_options.width))) + 1;
+  out += '[';
+  for (int i = 0; i < width; i++) {
+    if (i) out += ',';
+    value(out, level, limit);
+  }
+  out += ']';
+}
+
+void Generator::scalar(std::string &out) {
+  double pick = uniform();
+  if (pick < m_options.string_ratio) {
+    string(out);
+  } else if (pick < m_options.string_ratio + m_options.number_ratio) {
+    char buf[32];
+    if (next() & 1) {
+      snprintf(buf, sizeof buf, "%d", int(int64_t(below(2000000000)) - 1000000000));
+    } else {
+      snprintf(buf, sizeof buf, "%.17g", (uniform() - 0.5) * 1e6);
+    }
+    out += buf;
+  } else {
+    static const char *const literals[] = {"true", "false", "null"};
+    out += literals[below(3)];
+  }
+}
+
+void Generator::string(std::string &out) {
+  static const char *const escapes[] = {"\\n", "\\\"", "\\\\", "\\t", "\\u00e9", "\\ud83d\\ude00"};
+  int length = int(below(32)) + 1;
+  out += '"';
+  for (int i = 0; i < length; i++) {
+    if (uniform() < m_options.escape_ratio) {
+      out += escapes[below(sizeof escapes / sizeof escapes[0])];
+    } else {
+      out += char('a' + below(26));
+    }
+  }
+  out += '"';
+}
+
+template <class Sink>
+void Generator::generate(Sink &&flush) {
+  std::string out;
+  uint64_t written = 0;
+  bool first = true;
+  if (!m_options.ndjson) out += '[';
+  while (written + out.size() < m_options.target_bytes) {
+    if (!m_options.ndjson && !first) out += ',';
+    record(out);
+    if (m_options.ndjson) out += '\n';
+    first = false;
+    if (out.size() >= (1 << 20)) {
+      written += out.size();
+      flush(out);
+      out.clear();
+    }
+  }
+  if (!m_options.ndjson) out += ']';
+  flush(out);
+}
+
+std::string Generator::document() {
+  std::string doc;
+  doc.reserve(size_t(m_options.target_bytes) + 4096);
+  generate([&doc](const std::string &chunk) { doc += chunk; });
+  return doc;
+}
+
+void Generator::write(std::ostream &os) {
+  generate([&os](const std::string &chunk) { os.write(chunk.data(), std::streamsize(chunk.size())); });
+}
+
+}  // namespace bench
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+namespace bench {
+
+// Shape of generated documents. The same options and seed always produce
+// the same bytes, on every platform.
+struct GeneratorOptions {
+  uint64_t seed = 1;
+  // approximate output size, records are never cut
+  uint64_t target_bytes = 1 << 20;
+  // nesting depth of every record, 1 = flat object
+  int depth = 4;
+  // children per container, chosen in [1, width]
+  int width = 8;
+  // scalar mix, the rest are true/false/null
+  double string_ratio = 0.4;
+  double number_ratio = 0.4;
+  // fraction of string characters written as escapes
+  double escape_ratio = 0.02;
+  // distinct object keys across the whole document
+  uint32_t key_cardinality = 64;
+  // one record per line instead of one top-level array
+  bool ndjson = false;
+};
+
+class Generator {
+ public:
+  explicit Generator(const GeneratorOptions &options);
+
+  // append one record (an object nested options.depth levels deep)
+  void record(std::string &out);
+
+  // the whole document in memory
+  std::string document();
+
+  // stream the whole document, buffering at most ~1 MiB
+  void write(std::ostream &os);
+
+ private:
+  uint64_t next();
+  double uniform();
+  uint64_t below(uint64_t n);
+
+  void value(std::string &out, int level, int limit);
+  void object(std::string &out, int level, int limit, bool chain);
+  void array(std::string &out, int level, int limit);
+  void scalar(std::string &out);
+  void string(std::string &out);
+
+  template <class Sink>
+  void generate(Sink &&flush);
+
+  GeneratorOptions m_options;
+  uint64_t m_state;
+};
+
+}  // namespace bench
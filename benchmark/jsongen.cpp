@@ -0,0 +1,83 @@
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+
+#include "generator.hpp"
+
+// Command line front end for bench::Generator
+//   jsongen --size 100M --depth 8 --width 8 --strings 0.4 --numbers 0.4
+//           --escapes 0.02 --keys 64 --seed 1 [--ndjson] [-o out.json]
+
+static uint64_t parse_size(const char *text) {
+  char *end = nullptr;
+  double value = std::strtod(text, &end);
+  switch (*end) {
+    case 'k': case 'K': value *= 1024.0; break;
+    case 'm': case 'M': value *= 1024.0 * 1024.0; break;
+    case 'g': case 'G': value *= 1024.0 * 1024.0 * 1024.0; break;
+    default: break;
+  }
+  return uint64_t(value);
+}
+
+static void usage() {
+  std::cerr << "usage: jsongen [--size N[K|M|G]] [--depth N] [--width N] [--strings R]\n"
+               "               [--numbers R] [--escapes R] [--keys N] [--seed N]\n"
+               "               [--ndjson] [-o FILE]" << std::endl;
+}
+
+int main(int argc, char **argv) {
+  bench::GeneratorOptions options;
+  std::string output;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--ndjson") {
+      options.ndjson = true;
+      continue;
+    }
+    if (i + 1 >= argc) {
+      usage();
+      return 1;
+    }
+    const char *value = argv[++i];
+    if (arg == "--size") {
+      options.target_bytes = parse_size(value);
+    } else if (arg == "--depth") {
+      options.depth = std::atoi(value);
+    } else if (arg == "--width") {
+      options.width = std::atoi(value);
+    } else if (arg == "--strings") {
+      options.string_ratio = std::atof(value);
+    } else if (arg == "--numbers") {
+      options.number_ratio = std::atof(value);
+    } else if (arg == "--escapes") {
+      options.escape_ratio = std::atof(value);
+    } else if (arg == "--keys") {
+      options.key_cardinality = uint32_t(std::strtoul(value, nullptr, 10));
+    } else if (arg == "--seed") {
+      options.seed = std::strtoull(value, nullptr, 10);
+    } else if (arg == "-o") {
+      output = value;
+    } else {
+      usage();
+      return 1;
+    }
+  }
+
+  bench::Generator generator(options);
+  if (output.empty()) {
+    generator.write(std::cout);
+    return 0;
+  }
+
+  std::ofstream fout(output, std::ios::binary);
+  if (!fout.is_open()) {
+    std::cerr << "can not open " << output << std::endl;
+    return 1;
+  }
+  generator.write(fout);
+  return fout ? 0 : 1;
+}
@@ -1,126 +1,290 @@
 #include <benchmark/benchmark.h>
 
-#include <filesystem>
-#include <fstream>
+#include <initializer_list>
 #include <iostream>
-#include <sstream>
-#include <string>
 #include <memory>
-#include <unordered_map>
+#include <string>
 
+#include "common.hpp"
 #include "jsonL.hpp"
 
-static std::string get_json(const std::string& file) {
-  std::ifstream ifs(file);
-  std::stringstream ss;
-  ss << ifs.rdbuf();
-  return ss.str();
+using bench::AllocTracker;
+
+// What BM_Dump serializes: the parsed document, its cached() copy, or the
+// document text as a raw fragment inside an object
+enum class DumpInput { kParsed, kCached, kRaw };
+
+// Settings a benchmark runs under, name is appended to the benchmark's.
+// Each benchmark reads the fields that apply to it.
+struct Variant {
+  explicit Variant(const char *name) : name(name) {}
+
+  const char *name;
+  jsonL::JsonParseOptions options;
+  jsonL::JsonFormat format;
+  DumpInput input = DumpInput::kParsed;
+};
+
+static const jsonL::JsonProjection kTwitterFields = {
+    "statuses.*.user.id", "statuses.*.text", "statuses.*.entities.hashtags"};
+
+static const Variant kPlain("");
+// arrays of only numbers packed into doubles
+static const Variant kPacked = [] {
+  Variant variant("Packed");
+  variant.options.pack_numbers = true;
+  return variant;
+}();
+// UTF-8 validation of every string
+static const Variant kUtf8 = [] {
+  Variant variant("Utf8");
+  variant.options.validate_utf8 = true;
+  return variant;
+}();
+// numbers kept as text
+static const Variant kLazy = [] {
+  Variant variant("Lazy");
+  variant.options.lazy_numbers = true;
+  return variant;
+}();
+// three fields per status, for twitter.json
+static const Variant kProjected = [] {
+  Variant variant("Projected");
+  variant.options.projection = &kTwitterFields;
+  return variant;
+}();
+// every non-ASCII code point escaped
+static const Variant kAscii = [] {
+  Variant variant("Ascii");
+  variant.format.ascii_only = true;
+  return variant;
+}();
+// the whole document embedded as a pre-serialized fragment
+static const Variant kRaw = [] {
+  Variant variant("Raw");
+  variant.input = DumpInput::kRaw;
+  return variant;
+}();
+// through Json::cached, text kept after the first pass
+static const Variant kCached = [] {
+  Variant variant("Cached");
+  variant.input = DumpInput::kCached;
+  return variant;
+}();
+
+static void set_processed(benchmark::State &state, const bench::Document *doc) {
+  state.SetLabel(doc->name);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(doc->json.size()));
+  state.SetItemsProcessed(int64_t(state.iterations()));
+}
+
+template <class Json>
+static void BM_Parse(benchmark::State &state, const bench::Document *doc, const Variant *variant) {
+  std::string err;
+  AllocTracker tracker;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Json::parse(doc->json, err, variant->options));
+  }
+  if (!err.empty()) {
+    state.SkipWithError(err.c_str());
+    return;
+  }
+
+  tracker.report(state);
+  set_processed(state, doc);
 }
 
+// well-formedness check only, no DOM
 template <class Json>
-static void BM_Parse(benchmark::State& state, std::string filename, std::string data) {
+static void BM_Validate(benchmark::State &state, const bench::Document *doc, const Variant *variant) {
   std::string err;
+  AllocTracker tracker;
   for (auto _ : state) {
-    Json::parse(data, err);
+    benchmark::DoNotOptimize(Json::validate(doc->json.data(), doc->json.size(), err, variant->options));
   }
   if (!err.empty()) {
-    std::cout << err << std::endl;
+    state.SkipWithError(err.c_str());
     return;
-  } 
+  }
 
-  state.SetLabel(filename);
-  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(data.size()));
+  tracker.report(state);
+  set_processed(state, doc);
 }
 
-template <typename Json>
-static void BM_Dump(benchmark::State &state, std::string filename,
-                      std::string data) {
+template <class Json>
+static void BM_Dump(benchmark::State &state, const bench::Document *doc, const Variant *variant) {
   std::string err;
-  auto json = Json::parse(data, err);
+  Json json;
+  if (variant->input == DumpInput::kRaw) {
+    json = typename Json::object{{"data", Json::raw(doc->json)}};
+  } else {
+    json = Json::parse(doc->json, err, variant->options);
+    if (variant->input == DumpInput::kCached) json = json.cached();
+  }
   if (!err.empty()) {
-    std::cout << err << std::endl;
+    state.SkipWithError(err.c_str());
     return;
-  } 
-  
+  }
+
+  AllocTracker tracker;
   for (auto _ : state) {
-      json.dump();
+    benchmark::DoNotOptimize(json.dump(variant->format));
   }
 
-  state.SetLabel(filename);
-  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(data.size()));
+  tracker.report(state);
+  set_processed(state, doc);
 }
 
-struct Item{
-  std::string filename;
-  std::string path;
-  bool existed = {false};
-  std::string json;
-};
+// text to text minify, no DOM
+template <class Json>
+static void BM_Minify(benchmark::State &state, const bench::Document *doc, const Variant *variant) {
+  std::string err, out;
+  AllocTracker tracker;
+  for (auto _ : state) {
+    out.clear();
+    benchmark::DoNotOptimize(Json::reformat(doc->json.data(), doc->json.size(), out, err,
+                                            jsonL::JsonFormat::minified(), variant->options));
+  }
+  if (!err.empty()) {
+    state.SkipWithError(err.c_str());
+    return;
+  }
 
-int main(int argc, char **argv) {
-  std::vector<std::string> files = {"book", "canada", "citm_catalog", "fgo",
-                                    "github_events", "gsoc-2018", "lottie", "otfcc", "poet", "twitter", "twitterscaped"};
-  // , "gsoc-2019", "lottie", "otfcc", "poet", "twitter", "twitterscaped"
-
-  //1. 初始化Items
-  std::unordered_map<std::string, std::unique_ptr<Item>> items;
-
-  for (auto& file : files) {
-    auto item_ptr(std::make_unique<Item>());
-    item_ptr->filename = file + ".json";
-    item_ptr->path = "../testdata/" + file + ".json";
-
-    std::ifstream ifs(item_ptr->path);
-    if (!ifs.is_open()) {
-      std::cout << "error : open file!" << std::endl;
-      break;
+  tracker.report(state);
+  set_processed(state, doc);
+}
+
+template <class Json>
+static void BM_RoundTrip(benchmark::State &state, const bench::Document *doc, const Variant *variant) {
+  std::string err;
+  AllocTracker tracker;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(Json::parse(doc->json, err, variant->options).dump(variant->format));
+  }
+  if (!err.empty()) {
+    state.SkipWithError(err.c_str());
+    return;
+  }
+
+  tracker.report(state);
+  set_processed(state, doc);
+}
+
+// touch every value through the public accessors
+template <class Json>
+static size_t traverse(const Json &json, double &sum) {
+  switch (json.type()) {
+    case Json::Type::NUMBER:
+      sum += json.number_value();
+      return 1;
+    case Json::Type::BOOL:
+      sum += json.bool_value();
+      return 1;
+    case Json::Type::STRING:
+      sum += double(json.string_value().size());
+      return 1;
+    case Json::Type::ARRAY: {
+      jsonL::JsonNumberSpan numbers = json.packed_numbers();
+      if (numbers.data) {
+        for (double value : numbers) sum += value;
+        return 1 + numbers.size;
+      }
+      size_t nodes = 1;
+      for (const auto &item : json.array_items()) nodes += traverse(item, sum);
+      return nodes;
     }
-    item_ptr->existed = true;
-    
-    std::stringstream ss;
-    ss << ifs.rdbuf();
-    item_ptr->json = std::move(ss.str());
-    items[file] = std::move(item_ptr);
-  }
-  auto filename = items["fgo"]->filename;
-  auto data = items["fgo"]->json; 
-
-#define REGBM(ACT, JSON, FNAME)             \
-  do {                                      \
-      benchmark::RegisterBenchmark(         \
-        ("BM_" #ACT "-" #JSON "-" #FNAME),  \
-        BM_##ACT<JSON::Json>,               \
-        items[#FNAME]->filename,            \
-        items[#FNAME]->json);               \
-  } while (0)
+    case Json::Type::OBJECT: {
+      size_t nodes = 1;
+      for (const auto &item : json.object_items()) {
+        sum += double(item.first.size());
+        nodes += traverse(item.second, sum);
+      }
+      return nodes;
+    }
+    default:
+      return 1;
+  }
+}
 
-#define CMPJSON(ACT, FNAME)                 \
-  do {                                      \
-      REGBM(ACT, jsonL,FNAME);              \
-  } while (0)
+template <class Json>
+static void BM_Traverse(benchmark::State &state, const bench::Document *doc, const Variant *variant) {
+  std::string err;
+  auto json = Json::parse(doc->json, err, variant->options);
+  if (!err.empty()) {
+    state.SkipWithError(err.c_str());
+    return;
+  }
+
+  size_t nodes = 0;
+  AllocTracker tracker;
+  for (auto _ : state) {
+    double sum = 0;
+    nodes = traverse(json, sum);
+    benchmark::DoNotOptimize(sum);
+  }
+
+  tracker.report(state);
+  set_processed(state, doc);
+  state.counters["nodes"] = double(nodes);
+}
 
-#define CMP(FNAME)                          \
-  do {                                      \
-    CMPJSON(Parse, FNAME);                  \
-    CMPJSON(Dump, FNAME);                   \
+// parse outside the timed region, time only the tree teardown
+template <class Json>
+static void BM_Destroy(benchmark::State &state, const bench::Document *doc, const Variant *variant) {
+  std::string err;
+  for (auto _ : state) {
+    state.PauseTiming();
+    std::unique_ptr<Json> json(new Json(Json::parse(doc->json, err, variant->options)));
+    state.ResumeTiming();
+    json.reset();
+  }
+  if (!err.empty()) {
+    state.SkipWithError(err.c_str());
+    return;
+  }
+
+  set_processed(state, doc);
+}
+
+template <class Fn>
+static void register_variants(const std::string &action, const std::string &library, Fn fn,
+                              const bench::Document &doc, std::initializer_list<const Variant *> variants) {
+  for (const Variant *variant : variants) {
+    benchmark::RegisterBenchmark((action + variant->name + library + doc.name).c_str(), fn, &doc, variant);
+  }
+}
+
+// one benchmark per variant: BM_<ACT><variant>-<JSON>-<doc>
+#define REGBM(ACT, JSON, DOC, ...) \
+  register_variants("BM_" #ACT, "-" #JSON "-", BM_##ACT<JSON::Json>, DOC, {__VA_ARGS__})
+
+#define CMP(DOC)                                                  \
+  do {                                                            \
+    REGBM(Parse, jsonL, DOC, &kPlain, &kPacked, &kUtf8);          \
+    REGBM(Validate, jsonL, DOC, &kPlain);                         \
+    REGBM(Dump, jsonL, DOC, &kPlain, &kAscii, &kRaw, &kCached);   \
+    REGBM(RoundTrip, jsonL, DOC, &kPlain, &kLazy);                \
+    REGBM(Minify, jsonL, DOC, &kPlain);                           \
+    REGBM(Traverse, jsonL, DOC, &kPlain, &kPacked);               \
+    REGBM(Destroy, jsonL, DOC, &kPlain);                          \
   } while (0)
 
-   CMP(book);
-   CMP(canada);
-  // CMP(citm_catalog);
-  // CMP(fgo);
-  // CMP(github_events);
-  // CMP(gsoc-2018);
-  // CMP(lottie);
-  // CMP(otfcc);
-  // CMP(poet);
-  // CMP(twitter);
-  // CMP(twitterscaped);
+int main(int argc, char **argv) {
+  std::string dir = bench::testdata_dir();
+  static const std::vector<bench::Document> docs = bench::load_corpus(dir);
+  if (docs.empty()) {
+    std::cout << "error : no json files in " << dir << std::endl;
+    return 1;
+  }
+
+  for (const auto &doc : docs) {
+    CMP(doc);
+    if (doc.name == "twitter") REGBM(Parse, jsonL, doc, &kProjected);
+  }
 
+  bench::add_kernel_context();
   benchmark::Initialize(&argc, argv);
   benchmark::RunSpecifiedBenchmarks();
   benchmark::Shutdown();
   return 0;
 }
-
-
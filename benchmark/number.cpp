@@ -0,0 +1,150 @@
+#include <benchmark/benchmark.h>
+
+#include <cfloat>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "common.hpp"
+#include "jsonL.hpp"
+
+// Number-only workloads over testdata/num/*.txt, one number per line
+
+struct Category {
+  std::vector<std::string> texts;
+  std::vector<jsonL::Json> values;
+  std::string array;  // texts as one JSON array, see BM_ParseNumber
+  size_t roundtrip_errors = 0;
+};
+
+static size_t significant_digits(const std::string &text) {
+  size_t digits = 0;
+  bool leading = true;
+  for (char ch : text) {
+    if (ch == 'e' || ch == 'E') break;
+    if (ch < '0' || ch > '9') continue;
+    if (leading && ch == '0') continue;
+    leading = false;
+    digits++;
+  }
+  return digits;
+}
+
+static const char *classify(const std::string &text) {
+  bool integer = text.find_first_of(".eE") == std::string::npos;
+  if (integer) {
+    size_t digits = text.size() - (text[0] == '-');
+    return digits <= 9 ? "integer" : "int64_edge";
+  }
+  double value = std::strtod(text.c_str(), nullptr);
+  if (value != 0 && std::fabs(value) < DBL_MIN) return "subnormal";
+  if (significant_digits(text) > 17) return "long_mantissa";
+  return "decimal";
+}
+
+static bool same_number(double a, double b) {
+  return std::memcmp(&a, &b, sizeof a) == 0 || (std::isnan(a) && std::isnan(b));
+}
+
+// parse -> compare with strtod -> dump -> parse again
+static bool round_trips(const std::string &text, const jsonL::Json &json) {
+  double expected = std::strtod(text.c_str(), nullptr);
+  if (!same_number(json.number_value(), expected)) return false;
+  if (!std::isfinite(expected)) return true;  // dumped as null by design
+
+  std::string err;
+  jsonL::Json again = jsonL::Json::parse(json.dump(), err);
+  return err.empty() && same_number(again.number_value(), json.number_value());
+}
+
+static std::map<std::string, Category> load_numbers(const std::string &dir) {
+  std::map<std::string, Category> categories;
+  for (const char *file : {"float-1.txt", "float-4.txt", "float-8.txt"}) {
+    std::stringstream lines(bench::read_file(dir + "num/" + file));
+    std::string line;
+    while (std::getline(lines, line)) {
+      while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) line.pop_back();
+      if (line.empty() || line[0] == '#') continue;
+
+      std::string err;
+      jsonL::Json json = jsonL::Json::parse(line, err);
+      if (!err.empty() || !json.is_number()) continue;  // not JSON grammar
+
+      Category &category = categories[classify(line)];
+      if (!round_trips(line, json)) {
+        category.roundtrip_errors++;
+        std::cout << "round-trip mismatch : " << line << " -> " << json.dump() << std::endl;
+      }
+      category.array += category.array.empty() ? "[" : ",";
+      category.array += line;
+      category.texts.push_back(line);
+      category.values.push_back(json);
+    }
+  }
+  for (auto &item : categories) item.second.array += "]";
+  return categories;
+}
+
+// The category's numbers as one packed array: each goes from the number
+// scanner straight into a block of doubles, so per-call parse setup and
+// node allocation stay out of the per-number time
+static void BM_ParseNumber(benchmark::State &state, const Category *category) {
+  std::string err;
+  jsonL::JsonParseOptions options;
+  options.pack_numbers = true;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(jsonL::Json::parse(category->array, err, options));
+  }
+  if (!err.empty()) {
+    state.SkipWithError(err.c_str());
+    return;
+  }
+
+  int64_t bytes = 0;
+  for (const auto &text : category->texts) bytes += int64_t(text.size());
+  state.SetBytesProcessed(int64_t(state.iterations()) * bytes);
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(category->texts.size()));
+  state.counters["numbers"] = double(category->texts.size());
+  state.counters["roundtrip_errors"] = double(category->roundtrip_errors);
+}
+
+static void BM_DumpNumber(benchmark::State &state, const Category *category) {
+  std::string out;
+  for (auto _ : state) {
+    for (const auto &value : category->values) {
+      out.clear();
+      value.dump(out);
+      benchmark::DoNotOptimize(out.data());
+    }
+  }
+
+  state.SetItemsProcessed(int64_t(state.iterations()) * int64_t(category->values.size()));
+  state.counters["numbers"] = double(category->values.size());
+}
+
+int main(int argc, char **argv) {
+  static const std::map<std::string, Category> categories =
+      load_numbers(bench::testdata_dir());
+  if (categories.empty()) {
+    std::cout << "error : no numbers in " << bench::testdata_dir() << "num/" << std::endl;
+    return 1;
+  }
+
+  for (const auto &item : categories) {
+    benchmark::RegisterBenchmark(("BM_ParseNumber-" + item.first).c_str(),
+                                 BM_ParseNumber, &item.second);
+    benchmark::RegisterBenchmark(("BM_DumpNumber-" + item.first).c_str(),
+                                 BM_DumpNumber, &item.second);
+  }
+
+  bench::add_kernel_context();
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
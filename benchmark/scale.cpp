@@ -0,0 +1,163 @@
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <string>
+
+#include "common.hpp"
+#include "generator.hpp"
+#include "jsonL.hpp"
+
+// Throughput-vs-shape curves over generated documents. Sizes run from
+// 64 KiB up to $JSONL_SCALE_MAX bytes (default 64 MiB; K/M/G suffixes).
+
+using bench::AllocTracker;
+
+static void report(benchmark::State &state, const std::string &doc, const AllocTracker &tracker) {
+  tracker.report(state);
+  state.SetBytesProcessed(int64_t(state.iterations()) * int64_t(doc.size()));
+  state.SetItemsProcessed(int64_t(state.iterations()));
+  state.counters["doc_bytes"] = benchmark::Counter(
+      double(doc.size()), benchmark::Counter::kDefaults, benchmark::Counter::kIs1024);
+}
+
+static std::string generate(const bench::GeneratorOptions &options) {
+  return bench::Generator(options).document();
+}
+
+static void BM_ParseSize(benchmark::State &state) {
+  bench::GeneratorOptions options;
+  options.target_bytes = uint64_t(state.range(0));
+  std::string doc = generate(options);
+
+  std::string err;
+  AllocTracker tracker;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(jsonL::Json::parse(doc, err));
+  }
+  if (!err.empty()) state.SkipWithError(err.c_str());
+  report(state, doc, tracker);
+}
+
+static void BM_DumpSize(benchmark::State &state) {
+  bench::GeneratorOptions options;
+  options.target_bytes = uint64_t(state.range(0));
+  std::string doc = generate(options);
+  std::string err;
+  jsonL::Json json = jsonL::Json::parse(doc, err);
+
+  AllocTracker tracker;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(json.dump());
+  }
+  if (!err.empty()) state.SkipWithError(err.c_str());
+  report(state, doc, tracker);
+}
+
+static void BM_ParseNdjson(benchmark::State &state) {
+  bench::GeneratorOptions options;
+  options.target_bytes = uint64_t(state.range(0));
+  options.ndjson = true;
+  std::string doc = generate(options);
+
+  std::string err;
+  AllocTracker tracker;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(jsonL::Json::parse_multi(doc, err));
+  }
+  if (!err.empty()) state.SkipWithError(err.c_str());
+  report(state, doc, tracker);
+}
+
+static void BM_ParseDepth(benchmark::State &state) {
+  bench::GeneratorOptions options;
+  options.target_bytes = 4 << 20;
+  options.depth = int(state.range(0));
+  options.width = 2;
+  std::string doc = generate(options);
+
+  std::string err;
+  AllocTracker tracker;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(jsonL::Json::parse(doc, err));
+  }
+  if (!err.empty()) state.SkipWithError(err.c_str());
+  report(state, doc, tracker);
+}
+
+static void BM_ParseKeys(benchmark::State &state) {
+  bench::GeneratorOptions options;
+  options.target_bytes = 4 << 20;
+  options.key_cardinality = uint32_t(state.range(0));
+  options.width = 32;
+  std::string doc = generate(options);
+
+  std::string err;
+  AllocTracker tracker;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(jsonL::Json::parse(doc, err));
+  }
+  if (!err.empty()) state.SkipWithError(err.c_str());
+  report(state, doc, tracker);
+}
+
+// range(0) = percentage of scalars that are strings, the rest are numbers
+static void BM_ParseMix(benchmark::State &state) {
+  bench::GeneratorOptions options;
+  options.target_bytes = 4 << 20;
+  options.string_ratio = double(state.range(0)) / 100.0;
+  options.number_ratio = 1.0 - options.string_ratio;
+  std::string doc = generate(options);
+
+  std::string err;
+  AllocTracker tracker;
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(jsonL::Json::parse(doc, err));
+  }
+  if (!err.empty()) state.SkipWithError(err.c_str());
+  report(state, doc, tracker);
+}
+
+static int64_t scale_max() {
+  const char *env = std::getenv("JSONL_SCALE_MAX");
+  if (!env || !*env) return int64_t(64) << 20;
+  char *end = nullptr;
+  double value = std::strtod(env, &end);
+  switch (*end) {
+    case 'k': case 'K': value *= 1024.0; break;
+    case 'm': case 'M': value *= 1024.0 * 1024.0; break;
+    case 'g': case 'G': value *= 1024.0 * 1024.0 * 1024.0; break;
+    default: break;
+  }
+  return int64_t(value);
+}
+
+int main(int argc, char **argv) {
+  int64_t max_size = scale_max();
+
+  for (auto fn : {BM_ParseSize, BM_DumpSize, BM_ParseNdjson}) {
+    const char *name = fn == BM_ParseSize   ? "BM_ParseSize"
+                       : fn == BM_DumpSize ? "BM_DumpSize"
+                                           : "BM_ParseNdjson";
+    benchmark::RegisterBenchmark(name, fn)
+        ->RangeMultiplier(4)
+        ->Range(64 << 10, max_size)
+        ->Unit(benchmark::kMillisecond);
+  }
+  benchmark::RegisterBenchmark("BM_ParseDepth", BM_ParseDepth)
+      ->RangeMultiplier(2)
+      ->Range(1, 128)
+      ->Unit(benchmark::kMillisecond);
+  benchmark::RegisterBenchmark("BM_ParseKeys", BM_ParseKeys)
+      ->RangeMultiplier(8)
+      ->Range(8, 1 << 18)
+      ->Unit(benchmark::kMillisecond);
+  benchmark::RegisterBenchmark("BM_ParseMix", BM_ParseMix)
+      ->DenseRange(0, 100, 25)
+      ->Unit(benchmark::kMillisecond);
+
+  bench::add_kernel_context();
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
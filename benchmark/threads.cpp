@@ -0,0 +1,218 @@
+#include <benchmark/benchmark.h>
+
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "common.hpp"
+#include "jsonL.hpp"
+
+// Parse/dump/traverse on 1..N threads, over one shared document or one
+// document per thread. Besides the aggregate rates every run reports
+// docs/s/thread and efficiency = docs/s/thread relative to the 1-thread
+// run, so allocator or refcount contention shows up as a falling curve.
+
+using Clock = std::chrono::steady_clock;
+
+class Scaling {
+ public:
+  Scaling(benchmark::State &state, std::string key)
+      : m_state(state), m_key(std::move(key)) {}
+
+  void start() { m_start = Clock::now(); }
+
+  // call once per thread after the loop
+  void report(int64_t bytes_per_item) {
+    double seconds = std::chrono::duration<double>(Clock::now() - m_start).count();
+    double rate = seconds > 0 ? double(m_state.iterations()) / seconds : 0;
+
+    double baseline = rate;
+    {
+      std::lock_guard<std::mutex> lock(s_mutex);
+      if (m_state.threads() == 1) s_baseline[m_key] = rate;
+      if (s_baseline.count(m_key)) baseline = s_baseline[m_key];
+    }
+
+    m_state.counters["docs/s/thread"] =
+        benchmark::Counter(rate, benchmark::Counter::kAvgThreads);
+    m_state.counters["efficiency"] = benchmark::Counter(
+        baseline > 0 ? rate / baseline : 0, benchmark::Counter::kAvgThreads);
+    m_state.SetItemsProcessed(int64_t(m_state.iterations()));
+    if (bytes_per_item > 0) {
+      m_state.SetBytesProcessed(int64_t(m_state.iterations()) * bytes_per_item);
+    }
+  }
+
+ private:
+  benchmark::State &m_state;
+  // benchmark name without the thread count
+  std::string m_key;
+  Clock::time_point m_start;
+
+  static std::mutex s_mutex;
+  static std::map<std::string, double> s_baseline;
+};
+
+std::mutex Scaling::s_mutex;
+std::map<std::string, double> Scaling::s_baseline;
+
+template <class Json>
+static size_t traverse(const Json &json) {
+  size_t nodes = 1;
+  if (json.is_array()) {
+    for (const auto &item : json.array_items()) nodes += traverse(item);
+  } else if (json.is_object()) {
+    for (const auto &item : json.object_items()) nodes += traverse(item.second);
+  }
+  return nodes;
+}
+
+// every thread parses the same input buffer
+static void BM_ParseShared(benchmark::State &state, const bench::Document *doc) {
+  std::string err;
+  Scaling scaling(state, "ParseShared-" + doc->name);
+  scaling.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(jsonL::Json::parse(doc->json, err));
+  }
+  scaling.report(int64_t(doc->json.size()));
+}
+
+// every thread parses its own copy of the input
+static void BM_ParseOwn(benchmark::State &state, const bench::Document *doc) {
+  std::string input = doc->json;
+  std::string err;
+  Scaling scaling(state, "ParseOwn-" + doc->name);
+  scaling.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(jsonL::Json::parse(input, err));
+  }
+  scaling.report(int64_t(input.size()));
+}
+
+static jsonL::Json shared_json(const bench::Document *doc) {
+  static std::mutex mutex;
+  static std::map<const bench::Document *, jsonL::Json> cache;
+  std::lock_guard<std::mutex> lock(mutex);
+  auto iter = cache.find(doc);
+  if (iter == cache.end()) {
+    std::string err;
+    iter = cache.emplace(doc, jsonL::Json::parse(doc->json, err)).first;
+  }
+  return iter->second;
+}
+
+static void BM_DumpShared(benchmark::State &state, const bench::Document *doc) {
+  jsonL::Json json = shared_json(doc);
+  Scaling scaling(state, "DumpShared-" + doc->name);
+  scaling.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(json.dump());
+  }
+  scaling.report(int64_t(doc->json.size()));
+}
+
+static void BM_DumpOwn(benchmark::State &state, const bench::Document *doc) {
+  std::string err;
+  jsonL::Json json = jsonL::Json::parse(doc->json, err);
+  Scaling scaling(state, "DumpOwn-" + doc->name);
+  scaling.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(json.dump());
+  }
+  scaling.report(int64_t(doc->json.size()));
+}
+
+static void BM_TraverseShared(benchmark::State &state, const bench::Document *doc) {
+  jsonL::Json json = shared_json(doc);
+  Scaling scaling(state, "TraverseShared-" + doc->name);
+  scaling.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(traverse(json));
+  }
+  scaling.report(int64_t(doc->json.size()));
+}
+
+static void BM_TraverseOwn(benchmark::State &state, const bench::Document *doc) {
+  std::string err;
+  jsonL::Json json = jsonL::Json::parse(doc->json, err);
+  Scaling scaling(state, "TraverseOwn-" + doc->name);
+  scaling.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(traverse(json));
+  }
+  scaling.report(int64_t(doc->json.size()));
+}
+
+// null/bool construction and destruction on every thread; these share the
+// library singletons, so any refcount on them is contended across cores
+static void BM_Literals(benchmark::State &state) {
+  Scaling scaling(state, "Literals");
+  scaling.start();
+  for (auto _ : state) {
+    jsonL::Json values[] = {jsonL::Json(), jsonL::Json(nullptr),
+                            jsonL::Json(true), jsonL::Json(false)};
+    benchmark::DoNotOptimize(values);
+  }
+  scaling.report(0);
+}
+
+static void BM_ParseLiterals(benchmark::State &state) {
+  std::string data = "[";
+  for (int i = 0; i < 4096; i++) {
+    data += i % 3 == 0 ? "null," : i % 3 == 1 ? "true," : "false,";
+  }
+  data += "null]";
+
+  std::string err;
+  Scaling scaling(state, "ParseLiterals");
+  scaling.start();
+  for (auto _ : state) {
+    benchmark::DoNotOptimize(jsonL::Json::parse(data, err));
+  }
+  scaling.report(int64_t(data.size()));
+}
+
+int main(int argc, char **argv) {
+  static const std::vector<bench::Document> docs =
+      bench::load_corpus(bench::testdata_dir());
+  if (docs.empty()) {
+    std::cout << "error : no json files in " << bench::testdata_dir() << std::endl;
+    return 1;
+  }
+
+  int max_threads = std::max(1, int(std::thread::hardware_concurrency()));
+
+#define REGTHREADS(ACT, DOC)                                              \
+  benchmark::RegisterBenchmark(("BM_" #ACT "-" + (DOC).name).c_str(),     \
+                               BM_##ACT, &(DOC))                          \
+      ->ThreadRange(1, max_threads)                                       \
+      ->UseRealTime()
+
+  for (const auto &doc : docs) {
+    REGTHREADS(ParseShared, doc);
+    REGTHREADS(ParseOwn, doc);
+    REGTHREADS(DumpShared, doc);
+    REGTHREADS(DumpOwn, doc);
+    REGTHREADS(TraverseShared, doc);
+    REGTHREADS(TraverseOwn, doc);
+  }
+#undef REGTHREADS
+
+  benchmark::RegisterBenchmark("BM_Literals", BM_Literals)
+      ->ThreadRange(1, max_threads)
+      ->UseRealTime();
+  benchmark::RegisterBenchmark("BM_ParseLiterals", BM_ParseLiterals)
+      ->ThreadRange(1, max_threads)
+      ->UseRealTime();
+
+  bench::add_kernel_context();
+  benchmark::Initialize(&argc, argv);
+  benchmark::RunSpecifiedBenchmarks();
+  benchmark::Shutdown();
+  return 0;
+}
@@ -0,0 +1,62 @@
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "jsonL.hpp"
+
+// PGO training run: every file named on the command line goes through
+// parse and the dump styles a few times under the instrumented jsonL.
+//   jsonl_train [--passes N] file.json...
+
+static bool read_file(const std::string &path, std::string &out) {
+  std::ifstream in(path, std::ios::binary);
+  if (!in) return false;
+  std::stringstream buffer;
+  buffer << in.rdbuf();
+  out = buffer.str();
+  return true;
+}
+
+int main(int argc, char **argv) {
+  int passes = 3;
+  std::vector<std::string> docs;
+
+  for (int i = 1; i < argc; i++) {
+    std::string arg = argv[i];
+    if (arg == "--passes" && i + 1 < argc) {
+      passes = std::atoi(argv[++i]);
+      continue;
+    }
+    std::string text;
+    if (!read_file(arg, text)) {
+      std::cerr << "jsonl_train: can not read " << arg << std::endl;
+      return 1;
+    }
+    docs.push_back(std::move(text));
+  }
+  if (docs.empty()) {
+    std::cerr << "usage: jsonl_train [--passes N] file.json..." << std::endl;
+    return 1;
+  }
+
+  size_t bytes = 0;
+  for (int pass = 0; pass < passes; pass++) {
+    for (const std::string &text : docs) {
+      std::string err;
+      jsonL::Json json = jsonL::Json::parse(text, err);
+      if (!err.empty()) {
+        std::cerr << "jsonl_train: " << err << std::endl;
+        return 1;
+      }
+      bytes += json.dump().size();
+      bytes += json.dump(jsonL::JsonFormat::minified()).size();
+      bytes += json.dump(jsonL::JsonFormat::pretty()).size();
+    }
+  }
+  std::cout << "jsonl_train: " << docs.size() << " documents, " << passes
+            << " passes, " << bytes << " bytes dumped" << std::endl;
+  return 0;
+}
@@ -0,0 +1,75 @@
+# Profile-guided build of a jsonL library target.
+#
+#   jsonl_enable_pgo(<target> SOURCE <jsonL.cpp> TRAIN <train.cpp> CORPUS <dir>)
+#
+# builds <target>_instr from SOURCE with profile instrumentation, links
+# <target>_train against it, runs it over CORPUS/*.json (target
+# <target>_profile) and compiles <target> with the resulting profile.
+# GCC reads the .gcda files directly, Clang goes through llvm-profdata.
+
+if(COMMAND jsonl_enable_pgo)
+    return()
+endif()
+
+function(jsonl_enable_pgo target)
+    cmake_parse_arguments(PGO "" "SOURCE;TRAIN;CORPUS" "" ${ARGN})
+
+    set(instr ${target}_instr)
+    set(train ${target}_train)
+    set(profile_dir ${CMAKE_CURRENT_BINARY_DIR}/pgo/${target})
+    file(GLOB corpus ${PGO_CORPUS}/*.json)
+
+    get_filename_component(source ${PGO_SOURCE} ABSOLUTE)
+    get_filename_component(source_dir ${source} DIRECTORY)
+    get_target_property(definitions ${target} COMPILE_DEFINITIONS)
+    add_library(${instr} STATIC ${PGO_SOURCE})
+    target_include_directories(${instr} PUBLIC ${source_dir})
+    if(definitions)
+        target_compile_definitions(${instr} PUBLIC ${definitions})
+    endif()
+    add_executable(${train} ${PGO_TRAIN})
+    target_link_libraries(${train} ${instr})
+
+    if(CMAKE_CXX_COMPILER_ID STREQUAL "GNU")
+        if(CMAKE_CXX_COMPILER_VERSION VERSION_LESS 11)
+            message(FATAL_ERROR "JSONL_PGO needs GCC 11 or newer for -dumpdir/-dumpbase")
+        endif()
+        # .gcda names and the ids of internal functions follow the object
+        # path; pin the dump base so both objects look the same to gcov
+        get_filename_component(source_name ${source} NAME)
+        set(dump_base -dumpdir ${profile_dir}/ -dumpbase ${source_name})
+        set(generate -fprofile-generate=${profile_dir} ${dump_base})
+        set(use -fprofile-use=${profile_dir} -fprofile-partial-training ${dump_base})
+        set(merge "")
+    elseif(CMAKE_CXX_COMPILER_ID MATCHES "Clang")
+        find_program(LLVM_PROFDATA NAMES llvm-profdata llvm-profdata-${CMAKE_CXX_COMPILER_VERSION_MAJOR})
+        if(NOT LLVM_PROFDATA)
+            message(FATAL_ERROR "JSONL_PGO with Clang needs llvm-profdata")
+        endif()
+        set(generate -fprofile-generate=${profile_dir})
+        set(use -fprofile-use=${profile_dir}/jsonL.profdata)
+        set(merge COMMAND ${LLVM_PROFDATA} merge -o ${profile_dir}/jsonL.profdata ${profile_dir}/train.profraw)
+    else()
+        message(FATAL_ERROR "JSONL_PGO supports GCC and Clang, not ${CMAKE_CXX_COMPILER_ID}")
+    endif()
+
+    target_compile_options(${instr} PRIVATE ${generate})
+    target_link_options(${instr} PUBLIC -fprofile-generate=${profile_dir})
+
+    # stale counters would be merged into the new run, start from scratch
+    add_custom_command(
+        OUTPUT ${profile_dir}/profile.stamp
+        COMMAND ${CMAKE_COMMAND} -E remove_directory ${profile_dir}
+        COMMAND ${CMAKE_COMMAND} -E make_directory ${profile_dir}
+        COMMAND ${CMAKE_COMMAND} -E env LLVM_PROFILE_FILE=${profile_dir}/train.profraw
+                $<TARGET_FILE:${train}> ${corpus}
+        ${merge}
+        COMMAND ${CMAKE_COMMAND} -E touch ${profile_dir}/profile.stamp
+        DEPENDS ${train} ${corpus}
+        COMMENT "Training ${target} on ${PGO_CORPUS}"
+        VERBATIM)
+    add_custom_target(${target}_profile DEPENDS ${profile_dir}/profile.stamp)
+
+    target_compile_options(${target} PRIVATE ${use})
+    add_dependencies(${target} ${target}_profile)
+endfunction()
@@ -3,15 +3,73 @@
 #include <cassert>
 #include <limits>
 #include <cmath>
+#include <cstring>
 #include <sstream>
 #include <fstream>
 #include <iostream>
+#include <unordered_map>
+#include <algorithm>
+#include <type_traits>
+#include <atomic>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(JSONL_NO_SIMD)
+#include <immintrin.h>
+#endif
+
+#if defined(__unix__) || defined(__APPLE__)
+#define JSONL_HAS_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#ifdef JSONL_PARSE_STATS
+#include <chrono>
+#define JSONL_STAT(field, n)          \
+    do                                \
+    {                                 \
+        if (stats)                    \
+            stats->field += (n);      \
+    } while (0)
+#define JSONL_STAT_MAX(field, n)                  \
+    do                                            \
+    {                                             \
+        if (stats && stats->field < size_t(n))    \
+            stats->field = (n);                   \
+    } while (0)
+#define JSONL_STAT_NODE(T, extra) count_node(sizeof(T), (extra))
+#else
+// compiled out, operands stay unevaluated
+#define JSONL_STAT(field, n) ((void)sizeof(n))
+#define JSONL_STAT_MAX(field, n) ((void)sizeof(n))
+#define JSONL_STAT_NODE(T, extra) ((void)sizeof(extra))
+#endif
+
+/**
+ * USDT probes (provider "jsonL") for perf/bpftrace, compiled out without
+ * <sys/sdt.h> or with JSONL_NO_USDT. Unattached probes are a single nop.
+ */
+#if !defined(JSONL_NO_USDT) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define JSONL_HAS_USDT 1
+#endif
+#endif
+
+#ifdef JSONL_HAS_USDT
+#define JSONL_PROBE1(name, a) DTRACE_PROBE1(jsonL, name, a)
+#define JSONL_PROBE2(name, a, b) DTRACE_PROBE2(jsonL, name, a, b)
+#define JSONL_PROBE3(name, a, b, c) DTRACE_PROBE3(jsonL, name, a, b, c)
+#else
+#define JSONL_PROBE1(name, a) ((void)sizeof(a))
+#define JSONL_PROBE2(name, a, b) ((void)sizeof(a), (void)sizeof(b))
+#define JSONL_PROBE3(name, a, b, c) ((void)sizeof(a), (void)sizeof(b), (void)sizeof(c))
+#endif
 
 namespace jsonL
 {
 
-static const int max_depth = 200;
-
 using std::ifstream;
 using std::initializer_list;
 using std::make_shared;
@@ -22,270 +80,1526 @@ using std::string;
 using std::vector;
 
 /**
- * null-type -- do nothing
+ * Kernels: scalar loops plus SSE4.2/AVX2/AVX-512 variants of the same
+ * scans, built with target attributes and picked at load time. Each one
+ * returns the first byte in [p, end) that stops the scan, or end.
  */
-struct NullStruct
+static inline bool is_space(char ch)
 {
-    bool operator==(NullStruct) const { return true; }
-    bool operator<(NullStruct) const { return false; }
-};
+    return ch == ' ' || ch == '\t' || ch == '\n' || ch == '\r';
+}
 
-/**
- * Serialize
- */
-static void dump(NullStruct, string &out)
+static const char *skip_space_scalar(const char *p, const char *end)
 {
-    out += "null";
+    while (p != end && is_space(*p))
+        ++p;
+    return p;
 }
 
-static void dump(bool value, string &out)
+static const char *skip_digits_scalar(const char *p, const char *end)
 {
-    out += value ? "true" : "false";
+    while (p != end && *p >= '0' && *p <= '9')
+        ++p;
+    return p;
 }
 
-static void dump(int value, string &out)
+// '"', '\\' or a control byte: where a plain string run ends
+static const char *find_string_special_scalar(const char *p, const char *end)
 {
-    char buf[32];
-    snprintf(buf, sizeof buf, "%d", value);
-    out += buf;
+    while (p != end && *p != '"' && *p != '\\' && static_cast<uint8_t>(*p) >= 0x20)
+        ++p;
+    return p;
 }
 
-static void dump(double value, string &out)
+// as above plus 0xe2, the lead byte of U+2028/U+2029
+static const char *find_escape_scalar(const char *p, const char *end)
 {
-    if (std::isfinite(value))
+    while (p != end && *p != '"' && *p != '\\' && static_cast<uint8_t>(*p) >= 0x20 && static_cast<uint8_t>(*p) != 0xe2)
+        ++p;
+    return p;
+}
+
+// '"', '\\', a control byte or any non-ASCII byte, for ascii_only output
+static const char *find_ascii_escape_scalar(const char *p, const char *end)
+{
+    while (p != end && *p != '"' && *p != '\\' && static_cast<uint8_t>(*p) >= 0x20 && static_cast<uint8_t>(*p) < 0x80)
+        ++p;
+    return p;
+}
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && !defined(JSONL_NO_SIMD)
+#define JSONL_HAS_X86_KERNELS 1
+
+__attribute__((target("sse4.2"))) static const char *skip_space_sse42(const char *p, const char *end)
+{
+    const __m128i set = _mm_setr_epi8(' ', '\t', '\n', '\r', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    for (; end - p >= 16; p += 16)
     {
-        char buf[32];
-        snprintf(buf, sizeof buf, "%.17g", value);
-        out += buf;
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int idx = _mm_cmpestri(set, 4, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_ANY | _SIDD_NEGATIVE_POLARITY);
+        if (idx != 16)
+            return p + idx;
     }
-    else
+    return skip_space_scalar(p, end);
+}
+
+__attribute__((target("sse4.2"))) static const char *skip_digits_sse42(const char *p, const char *end)
+{
+    const __m128i range = _mm_setr_epi8('0', '9', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    for (; end - p >= 16; p += 16)
     {
-        out += "null";
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int idx = _mm_cmpestri(range, 2, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES | _SIDD_NEGATIVE_POLARITY);
+        if (idx != 16)
+            return p + idx;
     }
+    return skip_digits_scalar(p, end);
 }
 
-static void dump(const string &value, string &out)
+__attribute__((target("sse4.2"))) static const char *find_string_special_sse42(const char *p, const char *end)
 {
-    out += '"';
-    for (size_t i = 0; i < value.length(); i++)
+    const __m128i ranges = _mm_setr_epi8(0x00, 0x1f, '"', '"', '\\', '\\', 0, 0, 0, 0, 0, 0, 0, 0, 0, 0);
+    for (; end - p >= 16; p += 16)
     {
-        const char ch = value[i];
-        if (ch == '\\')
-        {
-            out += "\\\\";
-        }
-        else if (ch == '"')
-        {
-            out += "\\\"";
-        }
-        else if (ch == '\b')
-        {
-            out += "\\b";
-        }
-        else if (ch == '\f')
-        {
-            out += "\\f";
-        }
-        else if (ch == '\n')
-        {
-            out += "\\n";
-        }
-        else if (ch == '\r')
-        {
-            out += "\\r";
-        }
-        else if (ch == '\t')
-        {
-            out += "\\t";
-        }
-        else if (static_cast<uint8_t>(ch) <= 0x1f)
-        {
-            char buf[8];
-            snprintf(buf, sizeof buf, "\\u%04x", ch);
-            out += buf;
-        }
-        else if (static_cast<uint8_t>(ch) == 0xe2 && static_cast<uint8_t>(value[i + 1]) == 0x80 && static_cast<uint8_t>(value[i + 2]) == 0xa8)
-        {
-            out += "\\u2028";
-            i += 2;
-        }
-        else if (static_cast<uint8_t>(ch) == 0xe2 && static_cast<uint8_t>(value[i + 1]) == 0x80 && static_cast<uint8_t>(value[i + 2]) == 0xa9)
-        {
-            out += "\\u2029";
-            i += 2;
-        }
-        else
-        {
-            out += ch;
-        }
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int idx = _mm_cmpestri(ranges, 6, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+        if (idx != 16)
+            return p + idx;
     }
-    out += '"';
+    return find_string_special_scalar(p, end);
 }
 
-static void dump(const Json::array &values, string &out)
+__attribute__((target("sse4.2"))) static const char *find_escape_sse42(const char *p, const char *end)
 {
-    bool first = true;
-    out += "[";
-    for (const auto &value : values)
+    const __m128i ranges = _mm_setr_epi8(0x00, 0x1f, '"', '"', '\\', '\\', '\xe2', '\xe2', 0, 0, 0, 0, 0, 0, 0, 0);
+    for (; end - p >= 16; p += 16)
     {
-        if (!first)
-            out += ", ";
-        value.dump(out);
-        first = false;
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int idx = _mm_cmpestri(ranges, 8, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+        if (idx != 16)
+            return p + idx;
     }
-    out += "]";
+    return find_escape_scalar(p, end);
 }
 
-static void dump(const Json::object &values, string &out)
+__attribute__((target("sse4.2"))) static const char *find_ascii_escape_sse42(const char *p, const char *end)
 {
-    bool first = true;
-    out += "{";
-    for (const auto &value : values)
+    const __m128i ranges = _mm_setr_epi8(0x00, 0x1f, '"', '"', '\\', '\\', '\x80', '\xff', 0, 0, 0, 0, 0, 0, 0, 0);
+    for (; end - p >= 16; p += 16)
     {
-        if (!first)
-            out += ", ";
-        dump(value.first, out);
-        out += ": ";
-        value.second.dump(out);
-        first = false;
+        __m128i chunk = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+        int idx = _mm_cmpestri(ranges, 8, chunk, 16, _SIDD_UBYTE_OPS | _SIDD_CMP_RANGES);
+        if (idx != 16)
+            return p + idx;
     }
-    out += "}";
+    return find_ascii_escape_scalar(p, end);
 }
 
-void Json::dump(string &out) const
+__attribute__((target("avx2"))) static inline __m256i below_space_avx2(__m256i chunk)
 {
-    m_ptr->dump(out);
+    return _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, _mm256_set1_epi8(0x1f)), chunk);
 }
 
-/**
- * wrappers
- */
+__attribute__((target("avx2"))) static const char *skip_space_avx2(const char *p, const char *end)
+{
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i ws = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8(' ')),
+                                                     _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\t'))),
+                                     _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')),
+                                                     _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+        uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(ws));
+        if (stop)
+            return p + __builtin_ctz(stop);
+    }
+    return skip_space_scalar(p, end);
+}
 
-template <Json::Type tag, typename T>
-class Value : public JsonValue
+__attribute__((target("avx2"))) static const char *skip_digits_avx2(const char *p, const char *end)
 {
-protected:
-    const T m_value;
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i chunk = _mm256_sub_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i *>(p)), _mm256_set1_epi8('0'));
+        __m256i digit = _mm256_cmpeq_epi8(_mm256_min_epu8(chunk, _mm256_set1_epi8(9)), chunk);
+        uint32_t stop = ~static_cast<uint32_t>(_mm256_movemask_epi8(digit));
+        if (stop)
+            return p + __builtin_ctz(stop);
+    }
+    return skip_digits_scalar(p, end);
+}
 
-    // Constructors
-    explicit Value(const T &value) : m_value(value) {}
-    explicit Value(T &&value) : m_value(move(value)) {}
+__attribute__((target("avx2"))) static const char *find_string_special_avx2(const char *p, const char *end)
+{
+    for (; end - p >= 32; p += 32)
+    {
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+                                                          _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))),
+                                          below_space_avx2(chunk));
+        uint32_t hit = static_cast<uint32_t>(_mm256_movemask_epi8(special));
+        if (hit)
+            return p + __builtin_ctz(hit);
+    }
+    return find_string_special_scalar(p, end);
+}
 
-    // type
-    Json::Type type() const override
+__attribute__((target("avx2"))) static const char *find_escape_avx2(const char *p, const char *end)
+{
+    for (; end - p >= 32; p += 32)
     {
-        return tag;
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+                                                          _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))),
+                                          _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\xe2')),
+                                                          below_space_avx2(chunk)));
+        uint32_t hit = static_cast<uint32_t>(_mm256_movemask_epi8(special));
+        if (hit)
+            return p + __builtin_ctz(hit);
     }
-    bool equals(const JsonValue *other) const override
+    return find_escape_scalar(p, end);
+}
+
+__attribute__((target("avx2"))) static const char *find_ascii_escape_avx2(const char *p, const char *end)
+{
+    for (; end - p >= 32; p += 32)
     {
-        return m_value == static_cast<const Value<tag, T> *>(other)->m_value;
+        __m256i chunk = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+        __m256i special = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('"')),
+                                                          _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\\'))),
+                                          _mm256_or_si256(chunk, below_space_avx2(chunk)));
+        // the sign bit of chunk itself flags the non-ASCII bytes
+        uint32_t hit = static_cast<uint32_t>(_mm256_movemask_epi8(special));
+        if (hit)
+            return p + __builtin_ctz(hit);
     }
-    bool less(const JsonValue *other) const override
+    return find_ascii_escape_scalar(p, end);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static const char *skip_space_avx512(const char *p, const char *end)
+{
+    for (; end - p >= 64; p += 64)
     {
-        return m_value < static_cast<const Value<tag, T> *>(other)->m_value;
+        __m512i chunk = _mm512_loadu_si512(p);
+        __mmask64 ws = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8(' ')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\t')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\n')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\r'));
+        uint64_t stop = ~static_cast<uint64_t>(ws);
+        if (stop)
+            return p + __builtin_ctzll(stop);
     }
-    void dump(string &out) const override
+    return skip_space_avx2(p, end);
+}
+
+__attribute__((target("avx512f,avx512bw"))) static const char *skip_digits_avx512(const char *p, const char *end)
+{
+    for (; end - p >= 64; p += 64)
     {
-        jsonL::dump(m_value, out);
+        __m512i chunk = _mm512_sub_epi8(_mm512_loadu_si512(p), _mm512_set1_epi8('0'));
+        uint64_t stop = ~static_cast<uint64_t>(_mm512_cmple_epu8_mask(chunk, _mm512_set1_epi8(9)));
+        if (stop)
+            return p + __builtin_ctzll(stop);
     }
-};
+    return skip_digits_avx2(p, end);
+}
 
-class JsonDouble final : public Value<Json::Type::NUMBER, double>
+__attribute__((target("avx512f,avx512bw"))) static const char *find_string_special_avx512(const char *p, const char *end)
 {
-    double number_value() const override { return m_value; }
-    int int_value() const override { return static_cast<int>(m_value); }
-    // compare with JsonDouble or JsonInt
-    bool equals(const JsonValue *other) const override { return m_value == other->number_value(); }
-    bool less(const JsonValue *other) const override { return m_value < other->number_value(); }
+    for (; end - p >= 64; p += 64)
+    {
+        __m512i chunk = _mm512_loadu_si512(p);
+        uint64_t hit = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('"')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\\')) |
+                       _mm512_cmple_epu8_mask(chunk, _mm512_set1_epi8(0x1f));
+        if (hit)
+            return p + __builtin_ctzll(hit);
+    }
+    return find_string_special_avx2(p, end);
+}
 
-public:
-    explicit JsonDouble(double value) : Value(value) {}
-};
+__attribute__((target("avx512f,avx512bw"))) static const char *find_escape_avx512(const char *p, const char *end)
+{
+    for (; end - p >= 64; p += 64)
+    {
+        __m512i chunk = _mm512_loadu_si512(p);
+        uint64_t hit = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('"')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\\')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\xe2')) |
+                       _mm512_cmple_epu8_mask(chunk, _mm512_set1_epi8(0x1f));
+        if (hit)
+            return p + __builtin_ctzll(hit);
+    }
+    return find_escape_avx2(p, end);
+}
 
-class JsonInt final : public Value<Json::Type::NUMBER, int>
+__attribute__((target("avx512f,avx512bw"))) static const char *find_ascii_escape_avx512(const char *p, const char *end)
 {
-    double number_value() const override { return m_value; }
-    int int_value() const override { return m_value; }
-    // compare with JsonDouble or JsonInt
-    bool equals(const JsonValue *other) const override { return m_value == other->number_value(); }
-    bool less(const JsonValue *other) const override { return m_value < other->number_value(); }
+    for (; end - p >= 64; p += 64)
+    {
+        __m512i chunk = _mm512_loadu_si512(p);
+        uint64_t hit = _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('"')) |
+                       _mm512_cmpeq_epi8_mask(chunk, _mm512_set1_epi8('\\')) |
+                       _mm512_cmple_epu8_mask(chunk, _mm512_set1_epi8(0x1f)) |
+                       _mm512_movepi8_mask(chunk);
+        if (hit)
+            return p + __builtin_ctzll(hit);
+    }
+    return find_ascii_escape_avx2(p, end);
+}
 
-public:
-    explicit JsonInt(int value) : Value(value) {}
-};
+#endif
 
-class JsonBoolean final : public Value<Json::Type::BOOL, bool>
+/**
+ * UTF-8 validation. The scalar check walks one sequence at a time with
+ * an 8-byte ASCII skip; the SIMD ones use the lookup-table method of
+ * Keiser and Lemire, classifying each byte pair by three nibble tables.
+ */
+/**
+ * Length of the well-formed UTF-8 sequence starting at the non-ASCII byte
+ * *p, or 0 for a bad lead byte, a short tail, an overlong form, a
+ * surrogate or a code point past U+10FFFF
+ */
+static size_t utf8_sequence_length(const unsigned char *p, const unsigned char *end)
 {
-    bool bool_value() const override { return m_value; }
+    unsigned char lead = *p;
+    size_t length;
+    unsigned char low = 0x80, high = 0xbf; // allowed range of the second byte
+    if (lead < 0xc2)
+        return 0;
+    else if (lead < 0xe0)
+        length = 2;
+    else if (lead < 0xf0)
+    {
+        length = 3;
+        if (lead == 0xe0)
+            low = 0xa0; // overlong
+        else if (lead == 0xed)
+            high = 0x9f; // surrogates
+    }
+    else if (lead < 0xf5)
+    {
+        length = 4;
+        if (lead == 0xf0)
+            low = 0x90; // overlong
+        else if (lead == 0xf4)
+            high = 0x8f; // above U+10FFFF
+    }
+    else
+        return 0;
 
-public:
-    explicit JsonBoolean(bool value) : Value(value) {}
-};
+    if (static_cast<size_t>(end - p) < length || p[1] < low || p[1] > high)
+        return 0;
+    for (size_t k = 2; k < length; k++)
+    {
+        if ((p[k] & 0xc0) != 0x80)
+            return 0;
+    }
+    return length;
+}
 
-class JsonString final : public Value<Json::Type::STRING, string>
+static bool validate_utf8_scalar(const char *data, size_t size)
 {
-    const string &string_value() const override { return m_value; }
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(data);
+    const unsigned char *end = p + size;
+    while (p != end)
+    {
+        if (end - p >= 8)
+        {
+            uint64_t word;
+            memcpy(&word, p, sizeof word);
+            if (!(word & 0x8080808080808080ull))
+            {
+                p += 8;
+                continue;
+            }
+        }
+        if (*p < 0x80)
+        {
+            p++;
+            continue;
+        }
 
-public:
-    explicit JsonString(const string &value) : Value(value) {}
-    explicit JsonString(string &&value) : Value(move(value)) {}
-};
+        size_t length = utf8_sequence_length(p, end);
+        if (!length)
+            return false;
+        p += length;
+    }
+    return true;
+}
 
-class JsonArray final : public Value<Json::Type::ARRAY, Json::array>
+#ifdef JSONL_HAS_X86_KERNELS
+// error classes of a (previous byte, byte) pair
+enum : uint8_t
 {
-    const Json::array &array_items() const override { return m_value; }
-    const Json &operator[](size_t i) const override;
-
-public:
-    explicit JsonArray(const Json::array &value) : Value(value) {}
-    explicit JsonArray(Json::array &&value) : Value(move(value)) {}
+    UTF8_TOO_SHORT = 1 << 0,      // lead byte not followed by a continuation
+    UTF8_TOO_LONG = 1 << 1,       // continuation after ASCII
+    UTF8_OVERLONG_3 = 1 << 2,     // e0 80..9f
+    UTF8_TOO_LARGE = 1 << 3,      // f4 90..bf, f5..ff
+    UTF8_SURROGATE = 1 << 4,      // ed a0..bf
+    UTF8_OVERLONG_2 = 1 << 5,     // c0..c1
+    UTF8_TOO_LARGE_1000 = 1 << 6, // f5.. 80..
+    UTF8_OVERLONG_4 = 1 << 6,     // f0 80..8f
+    UTF8_TWO_CONTS = 1 << 7,      // continuation after continuation, unless 3rd/4th byte
+    UTF8_CARRY = UTF8_TOO_SHORT | UTF8_TOO_LONG | UTF8_TWO_CONTS
 };
 
-class JsonObject final : public Value<Json::Type::OBJECT, Json::object>
+#define JSONL_UTF8_BYTE_1_HIGH                                                              \
+    UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,                             \
+        UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG, UTF8_TOO_LONG,                         \
+        UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS, UTF8_TWO_CONTS,                     \
+        UTF8_TOO_SHORT | UTF8_OVERLONG_2, UTF8_TOO_SHORT,                                   \
+        UTF8_TOO_SHORT | UTF8_OVERLONG_3 | UTF8_SURROGATE,                                  \
+        UTF8_TOO_SHORT | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4
+
+#define JSONL_UTF8_BYTE_1_LOW                                                               \
+    UTF8_CARRY | UTF8_OVERLONG_3 | UTF8_OVERLONG_2 | UTF8_OVERLONG_4,                       \
+        UTF8_CARRY | UTF8_OVERLONG_2, UTF8_CARRY, UTF8_CARRY,                               \
+        UTF8_CARRY | UTF8_TOO_LARGE, UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,     \
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                                  \
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                                  \
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                                  \
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                                  \
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                                  \
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                                  \
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                                  \
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000 | UTF8_SURROGATE,                 \
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000,                                  \
+        UTF8_CARRY | UTF8_TOO_LARGE | UTF8_TOO_LARGE_1000
+
+#define JSONL_UTF8_BYTE_2_HIGH                                                              \
+    UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,                         \
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT,                     \
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 |                \
+            UTF8_TOO_LARGE_1000 | UTF8_OVERLONG_4,                                          \
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_OVERLONG_3 | UTF8_TOO_LARGE, \
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,  \
+        UTF8_TOO_LONG | UTF8_OVERLONG_2 | UTF8_TWO_CONTS | UTF8_SURROGATE | UTF8_TOO_LARGE,  \
+        UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT, UTF8_TOO_SHORT
+
+__attribute__((target("sse4.2"))) static inline __m128i utf8_errors_sse42(__m128i input, __m128i prev_input)
 {
-    const Json::object &object_items() const override { return m_value; }
-    const Json &operator[](const string &key) const override;
+    const __m128i byte_1_high_table = _mm_setr_epi8(JSONL_UTF8_BYTE_1_HIGH);
+    const __m128i byte_1_low_table = _mm_setr_epi8(JSONL_UTF8_BYTE_1_LOW);
+    const __m128i byte_2_high_table = _mm_setr_epi8(JSONL_UTF8_BYTE_2_HIGH);
+    const __m128i nibble = _mm_set1_epi8(0x0f);
 
-public:
-    explicit JsonObject(const Json::object &value) : Value(value) {}
-    explicit JsonObject(Json::object &&value) : Value(value) {}
-};
+    __m128i prev1 = _mm_alignr_epi8(input, prev_input, 15);
+    __m128i byte_1_high = _mm_shuffle_epi8(byte_1_high_table, _mm_and_si128(_mm_srli_epi16(prev1, 4), nibble));
+    __m128i byte_1_low = _mm_shuffle_epi8(byte_1_low_table, _mm_and_si128(prev1, nibble));
+    __m128i byte_2_high = _mm_shuffle_epi8(byte_2_high_table, _mm_and_si128(_mm_srli_epi16(input, 4), nibble));
+    __m128i special = _mm_and_si128(_mm_and_si128(byte_1_high, byte_1_low), byte_2_high);
 
-class JsonNull final : public Value<Json::Type::NUL, NullStruct>
+    // third and fourth bytes of a sequence are the only allowed TWO_CONTS
+    __m128i prev2 = _mm_alignr_epi8(input, prev_input, 14);
+    __m128i prev3 = _mm_alignr_epi8(input, prev_input, 13);
+    __m128i third = _mm_subs_epu8(prev2, _mm_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+    __m128i fourth = _mm_subs_epu8(prev3, _mm_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+    __m128i must_continue = _mm_and_si128(_mm_or_si128(third, fourth), _mm_set1_epi8(static_cast<char>(0x80)));
+    return _mm_xor_si128(must_continue, special);
+}
+
+// non-zero where the block ends inside a sequence
+__attribute__((target("sse4.2"))) static inline __m128i utf8_incomplete_sse42(__m128i input)
 {
-public:
-    JsonNull() : Value({}) {}
-};
+    const __m128i max = _mm_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                      static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1));
+    return _mm_subs_epu8(input, max);
+}
 
-/**
- * Static globals - static-init-safe
- */
-struct Statics
+__attribute__((target("sse4.2"))) static bool validate_utf8_sse42(const char *data, size_t size)
 {
-    const std::shared_ptr<JsonValue> null = make_shared<JsonNull>();
-    const std::shared_ptr<JsonValue> t = make_shared<JsonBoolean>(true);
-    const std::shared_ptr<JsonValue> f = make_shared<JsonBoolean>(false);
-    const string empty_string;
-    const vector<Json> empty_vector;
-    const map<string, Json> empty_map;
-    Statics() {}
-};
+    __m128i error = _mm_setzero_si128();
+    __m128i prev_input = _mm_setzero_si128();
+    __m128i prev_incomplete = _mm_setzero_si128();
+    for (size_t pos = 0; pos < size; pos += 16)
+    {
+        __m128i input;
+        if (size - pos >= 16)
+        {
+            input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + pos));
+        }
+        else
+        {
+            // zero padding is ASCII and flushes any incomplete sequence
+            char tail[16] = {};
+            memcpy(tail, data + pos, size - pos);
+            input = _mm_loadu_si128(reinterpret_cast<const __m128i *>(tail));
+        }
+        if (!_mm_movemask_epi8(input))
+        {
+            // all ASCII: only a sequence left open by the previous block is wrong
+            error = _mm_or_si128(error, prev_incomplete);
+            prev_incomplete = _mm_setzero_si128();
+        }
+        else
+        {
+            error = _mm_or_si128(error, utf8_errors_sse42(input, prev_input));
+            prev_incomplete = utf8_incomplete_sse42(input);
+        }
+        prev_input = input;
+    }
+    error = _mm_or_si128(error, prev_incomplete);
+    return _mm_testz_si128(error, error);
+}
 
-static const Statics &statics()
+__attribute__((target("avx2"))) static inline __m256i utf8_prev_avx2(__m256i input, __m256i prev_input, int n)
 {
-    static const Statics s{};
-    return s;
+    __m256i shifted = _mm256_permute2x128_si256(prev_input, input, 0x21);
+    switch (n)
+    {
+    case 1:
+        return _mm256_alignr_epi8(input, shifted, 15);
+    case 2:
+        return _mm256_alignr_epi8(input, shifted, 14);
+    default:
+        return _mm256_alignr_epi8(input, shifted, 13);
+    }
 }
 
-static const Json &static_null()
+__attribute__((target("avx2"))) static inline __m256i utf8_errors_avx2(__m256i input, __m256i prev_input)
 {
-    static const Json json_null;
-    return json_null;
+    const __m256i byte_1_high_table = _mm256_setr_epi8(JSONL_UTF8_BYTE_1_HIGH, JSONL_UTF8_BYTE_1_HIGH);
+    const __m256i byte_1_low_table = _mm256_setr_epi8(JSONL_UTF8_BYTE_1_LOW, JSONL_UTF8_BYTE_1_LOW);
+    const __m256i byte_2_high_table = _mm256_setr_epi8(JSONL_UTF8_BYTE_2_HIGH, JSONL_UTF8_BYTE_2_HIGH);
+    const __m256i nibble = _mm256_set1_epi8(0x0f);
+
+    __m256i prev1 = utf8_prev_avx2(input, prev_input, 1);
+    __m256i byte_1_high = _mm256_shuffle_epi8(byte_1_high_table, _mm256_and_si256(_mm256_srli_epi16(prev1, 4), nibble));
+    __m256i byte_1_low = _mm256_shuffle_epi8(byte_1_low_table, _mm256_and_si256(prev1, nibble));
+    __m256i byte_2_high = _mm256_shuffle_epi8(byte_2_high_table, _mm256_and_si256(_mm256_srli_epi16(input, 4), nibble));
+    __m256i special = _mm256_and_si256(_mm256_and_si256(byte_1_high, byte_1_low), byte_2_high);
+
+    __m256i third = _mm256_subs_epu8(utf8_prev_avx2(input, prev_input, 2), _mm256_set1_epi8(static_cast<char>(0xe0 - 0x80)));
+    __m256i fourth = _mm256_subs_epu8(utf8_prev_avx2(input, prev_input, 3), _mm256_set1_epi8(static_cast<char>(0xf0 - 0x80)));
+    __m256i must_continue = _mm256_and_si256(_mm256_or_si256(third, fourth), _mm256_set1_epi8(static_cast<char>(0x80)));
+    return _mm256_xor_si256(must_continue, special);
 }
 
-/**
- * Ctors
-*/
+__attribute__((target("avx2"))) static inline __m256i utf8_incomplete_avx2(__m256i input)
+{
+    const __m256i max = _mm256_setr_epi8(-1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                         -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+                                         static_cast<char>(0xf0 - 1), static_cast<char>(0xe0 - 1), static_cast<char>(0xc0 - 1));
+    return _mm256_subs_epu8(input, max);
+}
+
+__attribute__((target("avx2"))) static bool validate_utf8_avx2(const char *data, size_t size)
+{
+    __m256i error = _mm256_setzero_si256();
+    __m256i prev_input = _mm256_setzero_si256();
+    __m256i prev_incomplete = _mm256_setzero_si256();
+    for (size_t pos = 0; pos < size; pos += 32)
+    {
+        __m256i input;
+        if (size - pos >= 32)
+        {
+            input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + pos));
+        }
+        else
+        {
+            char tail[32] = {};
+            memcpy(tail, data + pos, size - pos);
+            input = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(tail));
+        }
+        if (!_mm256_movemask_epi8(input))
+        {
+            error = _mm256_or_si256(error, prev_incomplete);
+            prev_incomplete = _mm256_setzero_si256();
+        }
+        else
+        {
+            error = _mm256_or_si256(error, utf8_errors_avx2(input, prev_input));
+            prev_incomplete = utf8_incomplete_avx2(input);
+        }
+        prev_input = input;
+    }
+    error = _mm256_or_si256(error, prev_incomplete);
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+struct Kernels
+{
+    JsonKernel kind;
+    const char *(*skip_space)(const char *, const char *);
+    const char *(*skip_digits)(const char *, const char *);
+    const char *(*find_string_special)(const char *, const char *);
+    const char *(*find_escape)(const char *, const char *);
+    const char *(*find_ascii_escape)(const char *, const char *);
+    bool (*validate_utf8)(const char *, size_t);
+};
+
+static const Kernels scalar_kernels = {JsonKernel::SCALAR, skip_space_scalar, skip_digits_scalar,
+                                       find_string_special_scalar, find_escape_scalar, find_ascii_escape_scalar,
+                                       validate_utf8_scalar};
+#ifdef JSONL_HAS_X86_KERNELS
+static const Kernels sse42_kernels = {JsonKernel::SSE42, skip_space_sse42, skip_digits_sse42,
+                                      find_string_special_sse42, find_escape_sse42, find_ascii_escape_sse42,
+                                      validate_utf8_sse42};
+static const Kernels avx2_kernels = {JsonKernel::AVX2, skip_space_avx2, skip_digits_avx2,
+                                     find_string_special_avx2, find_escape_avx2, find_ascii_escape_avx2,
+                                     validate_utf8_avx2};
+static const Kernels avx512_kernels = {JsonKernel::AVX512, skip_space_avx512, skip_digits_avx512,
+                                       find_string_special_avx512, find_escape_avx512, find_ascii_escape_avx512,
+                                       validate_utf8_avx2};
+#endif
+
+/**
+ * Kernel table for kind, or nullptr if this CPU (or build) can't run it
+ */
+static const Kernels *supported_kernels(JsonKernel kind)
+{
+#ifdef JSONL_HAS_X86_KERNELS
+    __builtin_cpu_init();
+    switch (kind)
+    {
+    case JsonKernel::SCALAR:
+        return &scalar_kernels;
+    case JsonKernel::SSE42:
+        return __builtin_cpu_supports("sse4.2") ? &sse42_kernels : nullptr;
+    case JsonKernel::AVX2:
+        return __builtin_cpu_supports("avx2") ? &avx2_kernels : nullptr;
+    case JsonKernel::AVX512:
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw") ? &avx512_kernels : nullptr;
+    }
+    return nullptr;
+#else
+    return kind == JsonKernel::SCALAR ? &scalar_kernels : nullptr;
+#endif
+}
+
+static bool kernel_from_name(const string &name, JsonKernel &kind)
+{
+    static const JsonKernel all[] = {JsonKernel::SCALAR, JsonKernel::SSE42, JsonKernel::AVX2, JsonKernel::AVX512};
+    for (JsonKernel k : all)
+    {
+        if (name == Json::kernel_name(k))
+        {
+            kind = k;
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * JSONL_KERNEL from the environment, then the build default, then the
+ * widest kernel the CPU supports
+ */
+static const Kernels *initial_kernels()
+{
+    const char *forced = std::getenv("JSONL_KERNEL");
+#ifdef JSONL_DEFAULT_KERNEL
+    if (!forced || !*forced)
+        forced = JSONL_DEFAULT_KERNEL;
+#endif
+    JsonKernel kind;
+    if (forced && kernel_from_name(forced, kind) && supported_kernels(kind))
+        return supported_kernels(kind);
+
+    static const JsonKernel widest_first[] = {JsonKernel::AVX512, JsonKernel::AVX2, JsonKernel::SSE42};
+    for (JsonKernel k : widest_first)
+    {
+        if (const Kernels *table = supported_kernels(k))
+            return table;
+    }
+    return &scalar_kernels;
+}
+
+static std::atomic<const Kernels *> &kernel_slot()
+{
+    static std::atomic<const Kernels *> slot{initial_kernels()};
+    return slot;
+}
+
+static inline const Kernels &kernels()
+{
+    return *kernel_slot().load(std::memory_order_relaxed);
+}
+
+JsonKernel Json::kernel()
+{
+    return kernels().kind;
+}
+
+bool Json::set_kernel(JsonKernel kind)
+{
+    const Kernels *table = supported_kernels(kind);
+    if (!table)
+        return false;
+    kernel_slot().store(table, std::memory_order_relaxed);
+    return true;
+}
+
+bool Json::set_kernel(const string &name)
+{
+    JsonKernel kind;
+    return kernel_from_name(name, kind) && set_kernel(kind);
+}
+
+const char *Json::kernel_name(JsonKernel kind)
+{
+    switch (kind)
+    {
+    case JsonKernel::SCALAR:
+        return "scalar";
+    case JsonKernel::SSE42:
+        return "sse42";
+    case JsonKernel::AVX2:
+        return "avx2";
+    case JsonKernel::AVX512:
+        return "avx512";
+    }
+    return "unknown";
+}
+
+/**
+ * null-type -- do nothing
+ */
+struct NullStruct
+{
+    bool operator==(NullStruct) const { return true; }
+    bool operator<(NullStruct) const { return false; }
+};
+
+/**
+ * Serialize
+ */
+static void dump(NullStruct, string &out)
+{
+    out += "null";
+}
+
+static void dump(bool value, string &out)
+{
+    out += value ? "true" : "false";
+}
+
+static void dump(int value, string &out)
+{
+    char buf[32];
+    snprintf(buf, sizeof buf, "%d", value);
+    out += buf;
+}
+
+static void dump(double value, string &out)
+{
+    if (std::isfinite(value))
+    {
+        char buf[32];
+        snprintf(buf, sizeof buf, "%.17g", value);
+        out += buf;
+    }
+    else
+    {
+        out += "null";
+    }
+}
+
+// whether the parser reads value as an int; "-0" stays a double
+static bool exact_int(double value, int &int_value)
+{
+    if (!(value >= std::numeric_limits<int>::min() && value <= std::numeric_limits<int>::max()))
+        return false;
+    int_value = static_cast<int>(value);
+    return value == int_value && (int_value != 0 || !std::signbit(value));
+}
+
+// what the parser's int or double node for value would print
+static void dump_number(double value, string &out)
+{
+    int int_value;
+    if (exact_int(value, int_value))
+        dump(int_value, out);
+    else
+        dump(value, out);
+}
+
+// one UTF-16 unit as \uXXXX
+static void dump_unicode_escape(unsigned unit, string &out)
+{
+    static const char digits[] = "0123456789abcdef";
+    const char buf[6] = {'\\', 'u', digits[unit >> 12], digits[(unit >> 8) & 0xf], digits[(unit >> 4) & 0xf], digits[unit & 0xf]};
+    out.append(buf, sizeof buf);
+}
+
+/**
+ * The code point starting at the non-ASCII byte *p as \u escapes, a
+ * surrogate pair past U+FFFF and \ufffd for a malformed byte. Returns the
+ * bytes consumed.
+ */
+static size_t dump_unicode_escaped(const char *value, size_t length, string &out)
+{
+    const unsigned char *p = reinterpret_cast<const unsigned char *>(value);
+    size_t seq = utf8_sequence_length(p, p + length);
+    unsigned long pt;
+    if (seq == 2)
+        pt = (p[0] & 0x1ful) << 6 | (p[1] & 0x3f);
+    else if (seq == 3)
+        pt = (p[0] & 0x0ful) << 12 | (p[1] & 0x3ful) << 6 | (p[2] & 0x3f);
+    else if (seq == 4)
+        pt = (p[0] & 0x07ul) << 18 | (p[1] & 0x3ful) << 12 | (p[2] & 0x3ful) << 6 | (p[3] & 0x3f);
+    else
+        pt = 0xfffd, seq = 1;
+
+    if (pt >= 0x10000)
+    {
+        pt -= 0x10000;
+        dump_unicode_escape(0xd800 | (pt >> 10), out);
+        dump_unicode_escape(0xdc00 | (pt & 0x3ff), out);
+    }
+    else
+    {
+        dump_unicode_escape(pt, out);
+    }
+    return seq;
+}
+
+/**
+ * ascii_only escapes every non-ASCII code point, see dump_unicode_escaped
+ */
+static void dump(const char *value, size_t length, string &out, bool ascii_only = false)
+{
+    out += '"';
+    const Kernels &k = kernels();
+    const char *(*find_escape)(const char *, const char *) = ascii_only ? k.find_ascii_escape : k.find_escape;
+    for (size_t i = 0; i < length; i++)
+    {
+        // copy the run that needs no escaping in one go
+        size_t run = find_escape(value + i, value + length) - (value + i);
+        out.append(value + i, run);
+        i += run;
+        if (i == length)
+            break;
+
+        const char ch = value[i];
+        if (ch == '\\')
+        {
+            out += "\\\\";
+        }
+        else if (ch == '"')
+        {
+            out += "\\\"";
+        }
+        else if (ch == '\b')
+        {
+            out += "\\b";
+        }
+        else if (ch == '\f')
+        {
+            out += "\\f";
+        }
+        else if (ch == '\n')
+        {
+            out += "\\n";
+        }
+        else if (ch == '\r')
+        {
+            out += "\\r";
+        }
+        else if (ch == '\t')
+        {
+            out += "\\t";
+        }
+        else if (static_cast<uint8_t>(ch) <= 0x1f)
+        {
+            char buf[8];
+            snprintf(buf, sizeof buf, "\\u%04x", ch);
+            out += buf;
+        }
+        else if (ascii_only && static_cast<uint8_t>(ch) >= 0x80)
+        {
+            i += dump_unicode_escaped(value + i, length - i, out) - 1;
+        }
+        else if (static_cast<uint8_t>(ch) == 0xe2 && i + 2 < length && static_cast<uint8_t>(value[i + 1]) == 0x80 && static_cast<uint8_t>(value[i + 2]) == 0xa8)
+        {
+            out += "\\u2028";
+            i += 2;
+        }
+        else if (static_cast<uint8_t>(ch) == 0xe2 && i + 2 < length && static_cast<uint8_t>(value[i + 1]) == 0x80 && static_cast<uint8_t>(value[i + 2]) == 0xa9)
+        {
+            out += "\\u2029";
+            i += 2;
+        }
+        else
+        {
+            out += ch;
+        }
+    }
+    out += '"';
+}
+
+static void dump(const string &value, string &out, bool ascii_only = false)
+{
+    dump(value.data(), value.size(), out, ascii_only);
+}
+
+static void dump(JsonStringRef value, string &out, bool ascii_only = false)
+{
+    dump(value.data, value.size, out, ascii_only);
+}
+
+/**
+ * Layout policies, picked once per dump so the inner loops carry no style checks.
+ * first() runs before the first element, next() before every other one.
+ */
+struct StandardLayout
+{
+    void open(string &out, char ch) { out += ch; }
+    void first(string &) {}
+    void next(string &out) { out += ", "; }
+    void key(string &out) { out += ": "; }
+    void close(string &out, char ch, bool) { out += ch; }
+};
+
+struct MinifiedLayout
+{
+    void open(string &out, char ch) { out += ch; }
+    void first(string &) {}
+    void next(string &out) { out += ','; }
+    void key(string &out) { out += ':'; }
+    void close(string &out, char ch, bool) { out += ch; }
+};
+
+class PrettyLayout
+{
+public:
+    PrettyLayout(unsigned indent, char indent_char) : unit(indent), indent_char(indent_char), line("\n") {}
+
+    void open(string &out, char ch)
+    {
+        out += ch;
+        line.append(unit, indent_char);
+    }
+    void first(string &out) { out += line; }
+    void next(string &out)
+    {
+        out += ',';
+        out += line;
+    }
+    void key(string &out) { out += ": "; }
+    void close(string &out, char ch, bool empty)
+    {
+        line.resize(line.size() - unit);
+        if (!empty)
+            out += line;
+        out += ch;
+    }
+
+private:
+    unsigned unit;
+    char indent_char;
+    // newline plus the current indentation
+    string line;
+};
+
+template <class Layout>
+class JsonWriter final
+{
+public:
+    JsonWriter(string &out, Layout layout, bool sort_keys, bool ascii_only = false)
+        : out(out), layout(layout), sort_keys(sort_keys), ascii_only(ascii_only) {}
+
+    void write(const Json &json)
+    {
+        // the standard layout is what every node's own dump produces
+        if (std::is_same<Layout, StandardLayout>::value && !ascii_only)
+        {
+            json.m_ptr->dump(out);
+            return;
+        }
+
+        switch (json.type())
+        {
+        case Json::Type::ARRAY:
+        {
+            JsonNumberSpan numbers = json.packed_numbers();
+            if (numbers.data)
+                write_numbers(numbers);
+            else
+                write_array(json.array_items());
+            break;
+        }
+        case Json::Type::OBJECT:
+            write_object(json.object_items());
+            break;
+        case Json::Type::STRING:
+            dump(json.string_value(), out, ascii_only);
+            break;
+        case Json::Type::RAW:
+            write_raw(json);
+            break;
+        default:
+            // scalars look the same in every layout
+            json.m_ptr->dump(out);
+            break;
+        }
+    }
+
+    /**
+     * Raw text goes out as is in every layout. For ascii_only its non-ASCII
+     * bytes become \u escapes: valid JSON only has them inside strings,
+     * where the escape means the same.
+     */
+    void write_raw(const Json &json)
+    {
+        size_t start = out.size();
+        json.m_ptr->dump(out);
+        if (!ascii_only)
+            return;
+
+        const Kernels &k = kernels();
+        const char *text = out.data() + start;
+        const char *end = out.data() + out.size();
+        while (true)
+        {
+            text = k.find_ascii_escape(text, end);
+            if (text == end)
+                return;
+            if (static_cast<uint8_t>(*text) >= 0x80)
+                break;
+            text++;
+        }
+
+        // escape from the first non-ASCII byte on
+        string tail(text, end);
+        out.resize(text - out.data());
+        for (const char *p = tail.data(), *tail_end = p + tail.size(); p != tail_end;)
+        {
+            const char *stop = k.find_ascii_escape(p, tail_end);
+            out.append(p, stop - p);
+            if (stop == tail_end)
+                break;
+            if (static_cast<uint8_t>(*stop) >= 0x80)
+            {
+                p = stop + dump_unicode_escaped(stop, tail_end - stop, out);
+            }
+            else
+            {
+                out += *stop;
+                p = stop + 1;
+            }
+        }
+    }
+
+    void write_array(const Json::array &values)
+    {
+        layout.open(out, '[');
+        bool first = true;
+        for (const auto &value : values)
+        {
+            separate(first);
+            write(value);
+        }
+        layout.close(out, ']', values.empty());
+    }
+
+    void write_numbers(JsonNumberSpan values)
+    {
+        layout.open(out, '[');
+        bool first = true;
+        for (double value : values)
+        {
+            separate(first);
+            dump_number(value, out);
+        }
+        layout.close(out, ']', values.empty());
+    }
+
+    void write_object(const Json::object &values)
+    {
+        // std::map is sorted already
+        layout.open(out, '{');
+        bool first = true;
+        for (const auto &value : values)
+        {
+            separate(first);
+            dump(value.first, out, ascii_only);
+            layout.key(out);
+            write(value.second);
+        }
+        layout.close(out, '}', values.empty());
+    }
+
+    template <class View>
+    void write(const View &view)
+    {
+        switch (view.type())
+        {
+        case Json::Type::NUL:
+            out += "null";
+            break;
+        case Json::Type::BOOL:
+            jsonL::dump(view.bool_value(), out);
+            break;
+        case Json::Type::NUMBER:
+            dump_number(view.number_value(), out);
+            break;
+        case Json::Type::STRING:
+            dump(view.string_value(), out, ascii_only);
+            break;
+        case Json::Type::ARRAY:
+        {
+            layout.open(out, '[');
+            bool first = true;
+            for (const auto &value : view.array_items())
+            {
+                separate(first);
+                write(value);
+            }
+            layout.close(out, ']', first);
+            break;
+        }
+        case Json::Type::RAW:
+            // views never hold raw text
+            break;
+        case Json::Type::OBJECT:
+        {
+            layout.open(out, '{');
+            bool first = true;
+            if (sort_keys)
+            {
+                using member = std::pair<JsonStringRef, View>;
+                vector<member> members;
+                members.reserve(view.size());
+                for (const auto &value : view.object_items())
+                    members.push_back(value);
+                std::stable_sort(members.begin(), members.end(), [](const member &lhs, const member &rhs) {
+                    int cmp = memcmp(lhs.first.data, rhs.first.data, std::min(lhs.first.size, rhs.first.size));
+                    return cmp < 0 || (cmp == 0 && lhs.first.size < rhs.first.size);
+                });
+                // duplicates end up adjacent in document order, the last
+                // one wins as in Json::parse
+                for (size_t n = 0; n < members.size(); n++)
+                {
+                    if (n + 1 < members.size() && members[n].first == members[n + 1].first)
+                        continue;
+                    write_member(first, members[n].first, members[n].second);
+                }
+            }
+            else
+            {
+                for (const auto &value : view.object_items())
+                    write_member(first, value.first, value.second);
+            }
+            layout.close(out, '}', first);
+            break;
+        }
+        }
+    }
+
+private:
+    string &out;
+    Layout layout;
+    bool sort_keys;
+    bool ascii_only;
+
+    void separate(bool &first)
+    {
+        if (first)
+            layout.first(out);
+        else
+            layout.next(out);
+        first = false;
+    }
+
+    template <class View>
+    void write_member(bool &first, JsonStringRef key, const View &value)
+    {
+        separate(first);
+        dump(key, out, ascii_only);
+        layout.key(out);
+        write(value);
+    }
+};
+
+static void dump(const Json::array &values, string &out)
+{
+    JsonWriter<StandardLayout>(out, StandardLayout(), true).write_array(values);
+}
+
+static void dump(const Json::object &values, string &out)
+{
+    JsonWriter<StandardLayout>(out, StandardLayout(), true).write_object(values);
+}
+
+void Json::dump(string &out) const
+{
+    JSONL_PROBE1(dump__start, static_cast<int>(type()));
+    size_t start = out.size();
+    m_ptr->dump(out);
+    JSONL_PROBE2(dump__done, out.size() - start, static_cast<int>(type()));
+}
+
+template <class T>
+static void dump_formatted(const T &value, string &out, const JsonFormat &format)
+{
+    switch (format.style)
+    {
+    case JsonFormat::Style::MINIFIED:
+        JsonWriter<MinifiedLayout>(out, MinifiedLayout(), format.sort_keys, format.ascii_only).write(value);
+        break;
+    case JsonFormat::Style::PRETTY:
+        JsonWriter<PrettyLayout>(out, PrettyLayout(format.indent, format.indent_char), format.sort_keys,
+                                 format.ascii_only)
+            .write(value);
+        break;
+    default:
+        JsonWriter<StandardLayout>(out, StandardLayout(), format.sort_keys, format.ascii_only).write(value);
+        break;
+    }
+}
+
+void Json::dump(string &out, const JsonFormat &format) const
+{
+    JSONL_PROBE1(dump__start, static_cast<int>(type()));
+    size_t start = out.size();
+    if (format.style == JsonFormat::Style::STANDARD && !format.ascii_only)
+        m_ptr->dump(out);
+    else
+        dump_formatted(*this, out, format);
+    JSONL_PROBE2(dump__done, out.size() - start, static_cast<int>(type()));
+}
+
+/**
+ * wrappers
+ */
+
+template <Json::Type tag, typename T>
+class Value : public JsonValue
+{
+protected:
+    const T m_value;
+
+    // Constructors
+    explicit Value(const T &value) : m_value(value) {}
+    explicit Value(T &&value) : m_value(move(value)) {}
+
+    // type
+    Json::Type type() const override
+    {
+        return tag;
+    }
+    bool equals(const JsonValue *other) const override
+    {
+        return m_value == static_cast<const Value<tag, T> *>(other)->m_value;
+    }
+    bool less(const JsonValue *other) const override
+    {
+        return m_value < static_cast<const Value<tag, T> *>(other)->m_value;
+    }
+    void dump(string &out) const override
+    {
+        jsonL::dump(m_value, out);
+    }
+};
+
+class JsonDouble final : public Value<Json::Type::NUMBER, double>
+{
+    double number_value() const override { return m_value; }
+    int int_value() const override { return static_cast<int>(m_value); }
+    // compare with JsonDouble or JsonInt
+    bool equals(const JsonValue *other) const override { return m_value == other->number_value(); }
+    bool less(const JsonValue *other) const override { return m_value < other->number_value(); }
+
+public:
+    explicit JsonDouble(double value) : Value(value) {}
+};
+
+class JsonInt final : public Value<Json::Type::NUMBER, int>
+{
+    double number_value() const override { return m_value; }
+    int int_value() const override { return m_value; }
+    // compare with JsonDouble or JsonInt
+    bool equals(const JsonValue *other) const override { return m_value == other->number_value(); }
+    bool less(const JsonValue *other) const override { return m_value < other->number_value(); }
+
+public:
+    explicit JsonInt(int value) : Value(value) {}
+};
+
+/**
+ * A number kept as its source text, see JsonParseOptions::lazy_numbers.
+ * Converted on the first read and cached; readers racing on a shared
+ * value store the same bits.
+ */
+class JsonRawNumber final : public JsonValue
+{
+public:
+    JsonRawNumber(const char *text, size_t size) : m_size(size)
+    {
+        char *copy = m_short;
+        if (size >= sizeof m_short)
+        {
+            m_long.reset(new char[size + 1]);
+            copy = m_long.get();
+        }
+        memcpy(copy, text, size);
+        copy[size] = '\0';
+    }
+
+    // text that doesn't fit the node itself
+    static size_t heap_size(size_t size) { return size >= sizeof(m_short) ? size + 1 : 0; }
+
+private:
+    char m_short[24];
+    std::unique_ptr<char[]> m_long;
+    size_t m_size;
+    mutable std::atomic<uint64_t> m_bits{0};
+    mutable std::atomic<bool> m_converted{false};
+
+    const char *text() const { return m_long ? m_long.get() : m_short; }
+
+    Json::Type type() const override { return Json::Type::NUMBER; }
+    double number_value() const override
+    {
+        double value;
+        if (m_converted.load(std::memory_order_acquire))
+        {
+            uint64_t bits = m_bits.load(std::memory_order_relaxed);
+            memcpy(&value, &bits, sizeof value);
+            return value;
+        }
+        // the text passed the parser's number grammar, so strtod reads all of it
+        value = std::strtod(text(), nullptr);
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof bits);
+        m_bits.store(bits, std::memory_order_relaxed);
+        m_converted.store(true, std::memory_order_release);
+        return value;
+    }
+    int int_value() const override { return static_cast<int>(number_value()); }
+    bool equals(const JsonValue *other) const override { return number_value() == other->number_value(); }
+    bool less(const JsonValue *other) const override { return number_value() < other->number_value(); }
+    void dump(string &out) const override { out.append(text(), m_size); }
+};
+
+/**
+ * Wraps nodes that have no public Json constructor
+ */
+struct JsonBuilder
+{
+    static Json wrap(std::shared_ptr<JsonValue> node)
+    {
+        Json json;
+        json.m_ptr = move(node);
+        return json;
+    }
+};
+
+class JsonBoolean final : public Value<Json::Type::BOOL, bool>
+{
+    bool bool_value() const override { return m_value; }
+
+public:
+    explicit JsonBoolean(bool value) : Value(value) {}
+};
+
+class JsonString final : public Value<Json::Type::STRING, string>
+{
+    const string &string_value() const override { return m_value; }
+
+public:
+    explicit JsonString(const string &value) : Value(value) {}
+    explicit JsonString(string &&value) : Value(move(value)) {}
+};
+
+class JsonArray : public Value<Json::Type::ARRAY, Json::array>
+{
+    const Json::array &array_items() const override { return m_value; }
+    const Json &operator[](size_t i) const override;
+    // compare with JsonArray or JsonPackedArray
+    bool equals(const JsonValue *other) const override { return m_value == other->array_items(); }
+    bool less(const JsonValue *other) const override { return m_value < other->array_items(); }
+
+public:
+    explicit JsonArray(const Json::array &value) : Value(value) {}
+    explicit JsonArray(Json::array &&value) : Value(move(value)) {}
+};
+
+class JsonObject : public Value<Json::Type::OBJECT, Json::object>
+{
+    const Json::object &object_items() const override { return m_value; }
+    const Json &operator[](const string &key) const override;
+
+public:
+    explicit JsonObject(const Json::object &value) : Value(value) {}
+    explicit JsonObject(Json::object &&value) : Value(move(value)) {}
+};
+
+/**
+ * Array of numbers kept as doubles, see Json::packed. The element nodes
+ * are built once, on the first array_items() or operator[].
+ */
+class JsonPackedArray final : public JsonValue
+{
+    const vector<double> m_numbers;
+    mutable std::atomic<const Json::array *> m_items{nullptr};
+
+    Json::Type type() const override { return Json::Type::ARRAY; }
+    JsonNumberSpan packed_numbers() const override
+    {
+        JsonNumberSpan span;
+        span.data = m_numbers.data();
+        span.size = m_numbers.size();
+        return span;
+    }
+    bool equals(const JsonValue *other) const override
+    {
+        JsonNumberSpan numbers = other->packed_numbers();
+        if (numbers.data)
+            return m_numbers.size() == numbers.size && std::equal(m_numbers.begin(), m_numbers.end(), numbers.begin());
+        return array_items() == other->array_items();
+    }
+    bool less(const JsonValue *other) const override
+    {
+        JsonNumberSpan numbers = other->packed_numbers();
+        if (numbers.data)
+            return std::lexicographical_compare(m_numbers.begin(), m_numbers.end(), numbers.begin(), numbers.end());
+        return array_items() < other->array_items();
+    }
+    void dump(string &out) const override
+    {
+        JsonWriter<StandardLayout>(out, StandardLayout(), true).write_numbers(packed_numbers());
+    }
+    const Json::array &array_items() const override;
+    const Json &operator[](size_t i) const override;
+
+public:
+    explicit JsonPackedArray(vector<double> &&numbers) : m_numbers(move(numbers)) {}
+    ~JsonPackedArray() override { delete m_items.load(std::memory_order_relaxed); }
+};
+
+/**
+ * Shared accounting for JsonCached, see JsonDumpCacheLimits
+ */
+struct DumpCache
+{
+    std::atomic<size_t> min_bytes{JsonDumpCacheLimits().min_bytes};
+    std::atomic<size_t> max_bytes{JsonDumpCacheLimits().max_bytes};
+    std::atomic<size_t> nodes{0};
+    std::atomic<size_t> bytes{0};
+
+    bool reserve(size_t size)
+    {
+        if (size < min_bytes.load(std::memory_order_relaxed))
+            return false;
+        size_t limit = max_bytes.load(std::memory_order_relaxed);
+        if (bytes.fetch_add(size, std::memory_order_relaxed) + size > limit)
+        {
+            bytes.fetch_sub(size, std::memory_order_relaxed);
+            return false;
+        }
+        nodes.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    void release(size_t size)
+    {
+        bytes.fetch_sub(size, std::memory_order_relaxed);
+        nodes.fetch_sub(1, std::memory_order_relaxed);
+    }
+};
+
+static DumpCache &dump_cache()
+{
+    static DumpCache cache;
+    return cache;
+}
+
+/**
+ * Array or object that keeps its first dump. Threads racing on the first
+ * dump each render it; one publishes its copy, the rest free theirs.
+ */
+template <class Node>
+class JsonCached final : public Node
+{
+    mutable std::atomic<const string *> m_text{nullptr};
+
+    void dump(string &out) const override
+    {
+        if (const string *text = m_text.load(std::memory_order_acquire))
+        {
+            out += *text;
+            return;
+        }
+        size_t start = out.size();
+        Node::dump(out);
+        size_t size = out.size() - start;
+        if (!dump_cache().reserve(size))
+            return;
+        const string *text = new string(out, start, size);
+        const string *expected = nullptr;
+        if (!m_text.compare_exchange_strong(expected, text, std::memory_order_acq_rel))
+        {
+            dump_cache().release(size);
+            delete text;
+        }
+    }
+
+public:
+    template <class T>
+    explicit JsonCached(const T &value) : Node(value) {}
+    ~JsonCached() override
+    {
+        if (const string *text = m_text.load(std::memory_order_relaxed))
+        {
+            dump_cache().release(text->size());
+            delete text;
+        }
+    }
+};
+
+class JsonRaw final : public Value<Json::Type::RAW, string>
+{
+    void dump(string &out) const override { out += m_value; }
+
+public:
+    explicit JsonRaw(string &&value) : Value(move(value)) {}
+};
+
+class JsonNull final : public Value<Json::Type::NUL, NullStruct>
+{
+public:
+    JsonNull() : Value({}) {}
+};
+
+/**
+ * Static globals - static-init-safe
+ * null/true/false are immortal: the shared_ptrs alias them without a control
+ * block, so copying or destroying them never touches an atomic refcount.
+ */
+struct Statics
+{
+    JsonNull null_value;
+    JsonBoolean true_value{true};
+    JsonBoolean false_value{false};
+    const std::shared_ptr<JsonValue> null{std::shared_ptr<JsonValue>(), &null_value};
+    const std::shared_ptr<JsonValue> t{std::shared_ptr<JsonValue>(), &true_value};
+    const std::shared_ptr<JsonValue> f{std::shared_ptr<JsonValue>(), &false_value};
+    const string empty_string;
+    const vector<Json> empty_vector;
+    const map<string, Json> empty_map;
+    Statics() {}
+};
+
+static const Statics &statics()
+{
+    // never destroyed, so the singletons outlive every Json, static ones included
+    static const Statics *s = new Statics{};
+    return *s;
+}
+
+static const Json &static_null()
+{
+    static const Json json_null;
+    return json_null;
+}
+
+/**
+ * Ctors
+*/
 Json::Json() noexcept : m_ptr(statics().null) {}
 Json::Json(std::nullptr_t) noexcept : m_ptr(statics().null) {}
 Json::Json(double value) : m_ptr(make_shared<JsonDouble>(value)) {}
@@ -299,592 +1613,3076 @@ Json::Json(array &&values) : m_ptr(make_shared<JsonArray>(move(values))) {}
 Json::Json(const object &values) : m_ptr(make_shared<JsonObject>(values)) {}
 Json::Json(object &&values) : m_ptr(make_shared<JsonObject>(move(values))) {}
 
+Json Json::cached() const
+{
+    switch (type())
+    {
+    case Type::ARRAY:
+        return JsonBuilder::wrap(make_shared<JsonCached<JsonArray>>(array_items()));
+    case Type::OBJECT:
+        return JsonBuilder::wrap(make_shared<JsonCached<JsonObject>>(object_items()));
+    default:
+        return *this;
+    }
+}
+
+void Json::set_dump_cache_limits(const JsonDumpCacheLimits &limits)
+{
+    dump_cache().min_bytes.store(limits.min_bytes, std::memory_order_relaxed);
+    dump_cache().max_bytes.store(limits.max_bytes, std::memory_order_relaxed);
+}
+
+JsonDumpCacheLimits Json::dump_cache_limits()
+{
+    JsonDumpCacheLimits limits;
+    limits.min_bytes = dump_cache().min_bytes.load(std::memory_order_relaxed);
+    limits.max_bytes = dump_cache().max_bytes.load(std::memory_order_relaxed);
+    return limits;
+}
+
+JsonDumpCacheStats Json::dump_cache_stats()
+{
+    JsonDumpCacheStats stats;
+    stats.nodes = dump_cache().nodes.load(std::memory_order_relaxed);
+    stats.bytes = dump_cache().bytes.load(std::memory_order_relaxed);
+    return stats;
+}
+
+Json Json::packed(std::vector<double> values)
+{
+    if (values.empty())
+        return Json(array());
+    return JsonBuilder::wrap(make_shared<JsonPackedArray>(move(values)));
+}
+
+Json Json::raw(std::string text)
+{
+    return JsonBuilder::wrap(make_shared<JsonRaw>(move(text)));
+}
+
+Json Json::raw(std::string text, std::string &err)
+{
+    if (!validate(text.data(), text.size(), err))
+        return Json();
+    return raw(move(text));
+}
+
+/**
+ * Accessors
+ */
+Json::Type Json::type() const { return m_ptr->type(); }
+double Json::number_value() const { return m_ptr->number_value(); }
+int Json::int_value() const { return m_ptr->int_value(); }
+bool Json::bool_value() const { return m_ptr->bool_value(); }
+const string &Json::string_value() const { return m_ptr->string_value(); }
+const vector<Json> &Json::array_items() const { return m_ptr->array_items(); }
+const map<string, Json> &Json::object_items() const { return m_ptr->object_items(); }
+
+const Json &Json::operator[](size_t i) const { return (*m_ptr)[i]; }
+const Json &Json::operator[](const string &key) const { return (*m_ptr)[key]; }
+JsonNumberSpan Json::packed_numbers() const { return m_ptr->packed_numbers(); }
+
+double JsonValue::number_value() const { return 0; }
+int JsonValue::int_value() const { return 0; }
+bool JsonValue::bool_value() const { return false; }
+const string &JsonValue::string_value() const { return statics().empty_string; }
+const Json::array &JsonValue::array_items() const { return statics().empty_vector; }
+const Json &JsonValue::operator[](size_t i) const { return static_null(); }
+const Json::object &JsonValue::object_items() const { return statics().empty_map; }
+const Json &JsonValue::operator[](const string &key) const { return static_null(); }
+JsonNumberSpan JsonValue::packed_numbers() const { return JsonNumberSpan(); }
+
+const Json &JsonArray::operator[](size_t i) const
+{
+    if (i >= m_value.size())
+        return static_null();
+    else
+        return m_value[i];
+}
+
+const Json::array &JsonPackedArray::array_items() const
+{
+    if (const Json::array *items = m_items.load(std::memory_order_acquire))
+        return *items;
+    // integral values come back as the int nodes the parser would have made
+    Json::array *items = new Json::array();
+    items->reserve(m_numbers.size());
+    for (double value : m_numbers)
+    {
+        int int_value;
+        items->push_back(exact_int(value, int_value) ? Json(int_value) : Json(value));
+    }
+    const Json::array *expected = nullptr;
+    if (!m_items.compare_exchange_strong(expected, items, std::memory_order_acq_rel))
+    {
+        delete items;
+        return *expected;
+    }
+    return *items;
+}
+
+const Json &JsonPackedArray::operator[](size_t i) const
+{
+    if (i >= m_numbers.size())
+        return static_null();
+    return array_items()[i];
+}
+
+const Json &JsonObject::operator[](const string &key) const
+{
+    auto iter = m_value.find(key);
+    return (iter == m_value.end()) ? static_null() : iter->second;
+}
+
+/**
+ * Comparison
+ */
+
+bool Json::operator==(const Json &other) const
+{
+    if (m_ptr == other.m_ptr)
+        return true;
+    if (m_ptr->type() != other.m_ptr->type())
+        return false;
+    return m_ptr->equals(other.m_ptr.get());
+}
+
+bool Json::operator<(const Json &other) const
+{
+    if (m_ptr == other.m_ptr)
+        return false;
+    if (m_ptr->type() != other.m_ptr->type())
+        return m_ptr->type() < other.m_ptr->type();
+    return m_ptr->less(other.m_ptr.get());
+}
+
+/**
+ * Parse
+ */
+
+static inline string esc(char c)
+{
+    char buf[12];
+    if (static_cast<uint8_t>(c) >= 0x20 && static_cast<uint8_t>(c) <= 0x7f)
+    {
+        snprintf(buf, sizeof buf, "'%c' (%d)", c, c);
+    }
+    else
+    {
+        snprintf(buf, sizeof buf, "(%d)", c);
+    }
+    return string(buf);
+}
+
+static inline bool in_range(long x, long lower, long upper)
+{
+    return (x >= lower) && (x <= upper);
+}
+
+/**
+ * Hex digit values, -1 for anything else
+ */
+static const int8_t hex_digits[256] = {
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, 10, 11, 12, 13, 14, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,
+    -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1};
+
+namespace
+{
+
+/**
+ * Tape words: kind in the top byte, payload in the low 56 bits
+ */
+enum TapeKind : uint64_t
+{
+    TAPE_NUL = 'n',
+    TAPE_TRUE = 't',
+    TAPE_FALSE = 'f',
+    TAPE_INT = 'i',
+    TAPE_DOUBLE = 'd',
+    TAPE_STRING = 's',
+    TAPE_ARRAY = '[',
+    TAPE_ARRAY_END = ']',
+    TAPE_OBJECT = '{',
+    TAPE_OBJECT_END = '}'
+};
+
+static const uint64_t tape_payload_mask = (uint64_t(1) << 56) - 1;
+static const uint64_t tape_count_max = 0xffffff;
+static const uint64_t tape_index_max = 0xffffffff;
+
+inline uint64_t tape_word(uint64_t kind, uint64_t payload)
+{
+    return (kind << 56) | (payload & tape_payload_mask);
+}
+
+inline uint64_t tape_kind(uint64_t word)
+{
+    return word >> 56;
+}
+
+inline uint64_t tape_payload(uint64_t word)
+{
+    return word & tape_payload_mask;
+}
+
+/**
+ * Syntax policies for JsonParser, one per JsonParse strategy. Features are
+ * compile-time constants so a strict parser carries no code for them.
+ */
+struct StandardSyntax
+{
+    static const bool comments = false;
+    static const bool trailing_commas = false;
+    static const bool single_quotes = false;
+    static const bool unquoted_keys = false;
+    static const bool validate_utf8 = false;
+};
+
+struct CommentSyntax : StandardSyntax
+{
+    static const bool comments = true;
+};
+
+struct RelaxedSyntax
+{
+    static const bool comments = true;
+    static const bool trailing_commas = true;
+    static const bool single_quotes = true;
+    static const bool unquoted_keys = true;
+    static const bool validate_utf8 = false;
+};
+
+/**
+ * Any syntax, rejecting strings that are not valid UTF-8
+ */
+template <class Syntax>
+struct Utf8Syntax : Syntax
+{
+    static const bool validate_utf8 = true;
+};
+
+/**
+ * Deepest nesting Json::validate tracks, one bit per level
+ */
+static const size_t validate_depth_max = 4096;
+
+/**
+ * Token events for JsonValidator, these ones dropped
+ */
+struct NullSink
+{
+    void open(char) {}
+    void close(char, bool) {}
+    void separator(bool) {}
+    void colon() {}
+    void scalar(const char *, const char *) {}
+    // body of a string literal; quote 0 for a bare (relaxed) key
+    void string_literal(const char *, const char *, char) {}
+};
+
+template <class Syntax, class Sink = NullSink>
+struct JsonValidator;
+
+template <class Syntax>
+struct JsonParser final
+{
+    const string &str;
+    size_t i;
+    string &err;
+    bool failed;
+    JsonParseStats *stats;
+    const size_t depth_limit;
+    const bool lazy_numbers;
+    const bool pack_numbers;
+
+#ifdef JSONL_PARSE_STATS
+    // make_shared node plus its control block, and any payload outside it
+    void count_node(size_t node_size, size_t extra)
+    {
+        if (!stats)
+            return;
+        stats->nodes++;
+        stats->node_bytes += node_size + 2 * sizeof(long) + extra;
+    }
+#endif
+
+    // 设置错误信息，返回NULL
+    Json fail(string &&msg)
+    {
+        return fail(move(msg), Json());
+    }
+
+    template <typename T>
+    T fail(string &&msg, const T err_ret)
+    {
+        if (!failed)
+            err = std::move(msg);
+        failed = true;
+        return err_ret;
+    }
+
+    /*
+        * consume ws
+        * ws = *(%x20 / %x09 / %x0A / %x0D) 空格符space、制表符tab、换行符LF、回车符CR
+        */
+    void consume_whitespace()
+    {
+        if (!is_space(str[i]))
+            return;
+        size_t start = i;
+        i = kernels().skip_space(str.data() + i, str.data() + str.size()) - str.data();
+        JSONL_STAT(whitespace_bytes, i - start);
+    }
+
+    /**
+     * index of the first non-digit at or after pos
+     */
+    size_t skip_digits(size_t pos) const
+    {
+        return kernels().skip_digits(str.data() + pos, str.data() + str.size()) - str.data();
+    }
+
+    /**
+     * Consume comment
+     */
+    bool consume_comment()
+    {
+        bool comment_found = false;
+        if (str[i] == '/')
+        {
+            i++;
+            if (i == str.size())
+                return fail("unexpected end of input after start of comment", false);
+            if (str[i] == '/')
+            { // inline comment
+                i++;
+                // advance until next line, or end of input
+                while (i < str.size() && str[i] != '\n')
+                {
+                    i++;
+                }
+                comment_found = true;
+            }
+            else if (str[i] == '*')
+            { // multiline comment
+                i++;
+                if (i > str.size() - 2)
+                    return fail("unexpected end of input inside multi-line comment", false);
+                // advance until closing tokens
+                while (!(str[i] == '*' && str[i + 1] == '/'))
+                {
+                    i++;
+                    if (i > str.size() - 2)
+                        return fail(
+                            "unexpected end of input inside multi-line comment", false);
+                }
+                i += 2;
+                comment_found = true;
+            }
+            else
+                return fail("malformed comment", false);
+        }
+        return comment_found;
+    }
+
+    /**
+     * advance
+     */
+    void consume_garbage()
+    {
+        consume_whitespace();
+        if (Syntax::comments)
+        {
+            bool comment_found = false;
+            do
+            {
+                size_t start = i;
+                comment_found = consume_comment();
+                JSONL_STAT(comment_bytes, i - start);
+                if (failed)
+                    return;
+                consume_whitespace();
+            } while (comment_found);
+        }
+    }
+
+    /**
+     * get next token
+     */
+    char get_next_token()
+    {
+        consume_garbage();
+        if (failed)
+            return static_cast<char>(0);
+        if (i == str.size())
+            return fail("unexpected end of input", static_cast<char>(0));
+        return str[i++];
+    }
+
+    /**
+     * Scanned number, converted to int when it fits
+     */
+    struct Number
+    {
+        bool is_int;
+        int int_value;
+        double double_value;
+    };
+
+    /**
+     * Parse a double.
+     */
+    Json parse_number()
+    {
+        Number num;
+        if (!scan_number(num))
+            return Json();
+        if (num.is_int)
+            return num.int_value;
+        return num.double_value;
+    }
+
+    /**
+     * Step over a number, checking its grammar only. int_end is where the
+     * integer part stops.
+     */
+    bool skip_number(size_t &int_end)
+    {
+        if (str[i] == '-')
+            i++;
+
+        if (str[i] == '0')
+        {
+            i++;
+            if (in_range(str[i], '0', '9'))
+                return fail("leading 0s not permitted in numbers", false);
+        }
+        else if (in_range(str[i], '1', '9'))
+        {
+            i = skip_digits(i + 1);
+        }
+        else
+        {
+            return fail("invalid " + esc(str[i]) + "in number", false);
+        }
+        int_end = i;
+
+        if (str[i] == '.')
+        {
+            i++;
+            if (!in_range(str[i], '0', '9'))
+                return fail("at least one digit required in fractional part", false);
+
+            i = skip_digits(i);
+        }
+
+        if (str[i] == 'e' || str[i] == 'E')
+        {
+            i++;
+            if (str[i] == '+' || str[i] == '-')
+                i++;
+            if (!in_range(str[i], '0', '9'))
+                return fail("at least one digit required in exponent", false);
+            i = skip_digits(i);
+        }
+        return true;
+    }
+
+    bool scan_number(Number &num)
+    {
+        size_t start_pos = i;
+        size_t int_end;
+        if (!skip_number(int_end))
+            return false;
+        JSONL_STAT(number_bytes, i - start_pos);
+
+        if (int_end == i && (i - start_pos) <= static_cast<size_t>(std::numeric_limits<int>::digits10))
+        {
+            num.is_int = true;
+            num.int_value = std::atoi(str.c_str() + start_pos);
+            // "-0" has no int spelling, keep its sign as a double
+            if (num.int_value == 0 && str[start_pos] == '-')
+            {
+                num.is_int = false;
+                num.double_value = -0.0;
+            }
+            return true;
+        }
+
+        JSONL_STAT(strtod_fallbacks, 1);
+        num.is_int = false;
+        num.double_value = std::strtod(str.c_str() + start_pos, nullptr);
+        return true;
+    }
+
+    /**
+     * A number kept as its text, see JsonParseOptions::lazy_numbers
+     */
+    Json parse_raw_number()
+    {
+        size_t start_pos = i;
+        size_t int_end;
+        if (!skip_number(int_end))
+            return Json();
+        JSONL_STAT(number_bytes, i - start_pos);
+        JSONL_STAT_NODE(JsonRawNumber, JsonRawNumber::heap_size(i - start_pos));
+        return JsonBuilder::wrap(make_shared<JsonRawNumber>(str.data() + start_pos, i - start_pos));
+    }
+
+    /**
+     * encode UTF-8
+     */
+    static size_t encode_utf8(long pt, char *out)
+    {
+        if (pt < 0x80)
+        {
+            out[0] = static_cast<char>(pt);
+            return 1;
+        }
+        if (pt < 0x800)
+        {
+            out[0] = static_cast<char>((pt >> 6) | 0xC0);
+            out[1] = static_cast<char>((pt & 0x3F) | 0x80);
+            return 2;
+        }
+        if (pt < 0x10000)
+        {
+            out[0] = static_cast<char>((pt >> 12) | 0xE0);
+            out[1] = static_cast<char>(((pt >> 6) & 0x3F) | 0x80);
+            out[2] = static_cast<char>((pt & 0x3F) | 0x80);
+            return 3;
+        }
+        out[0] = static_cast<char>((pt >> 18) | 0xF0);
+        out[1] = static_cast<char>(((pt >> 12) & 0x3F) | 0x80);
+        out[2] = static_cast<char>(((pt >> 6) & 0x3F) | 0x80);
+        out[3] = static_cast<char>((pt & 0x3F) | 0x80);
+        return 4;
+    }
+
+    /**
+     * Value of the four hex digits at pos, -1 if any is missing or not hex
+     */
+    long decode_hex4(size_t pos) const
+    {
+        if (str.size() - pos < 4)
+            return -1;
+        const unsigned char *p = reinterpret_cast<const unsigned char *>(str.data() + pos);
+        int d0 = hex_digits[p[0]], d1 = hex_digits[p[1]], d2 = hex_digits[p[2]], d3 = hex_digits[p[3]];
+        // an invalid digit is -1, so one sign test covers all four
+        if ((d0 | d1 | d2 | d3) < 0)
+            return -1;
+        return (d0 << 12) | (d1 << 8) | (d2 << 4) | d3;
+    }
+
+    /**
+     * Opening quote of a string
+     */
+    static bool is_quote(char ch)
+    {
+        return ch == '"' || (Syntax::single_quotes && ch == '\'');
+    }
+
+    static bool is_identifier(char ch)
+    {
+        return in_range(ch, 'a', 'z') || in_range(ch, 'A', 'Z') || in_range(ch, '0', '9') || ch == '_' || ch == '$';
+    }
+
+    /**
+     * Parse a string, quote is the character that opened it
+     */
+    string parse_string(char quote = '"')
+    {
+        string out;
+        if (!parse_string_into(out, quote))
+            return "";
+        return out;
+    }
+
+    /**
+     * Parse an object key, a string or (relaxed) a bare identifier
+     */
+    string parse_key_string(char ch)
+    {
+        if (!Syntax::unquoted_keys || is_quote(ch))
+            return parse_string(ch);
+        size_t start = i - 1;
+        while (is_identifier(str[i]))
+            i++;
+        return str.substr(start, i - start);
+    }
+
+    static bool starts_key(char ch)
+    {
+        return is_quote(ch) || (Syntax::unquoted_keys && is_identifier(ch) && !in_range(ch, '0', '9'));
+    }
+
+    /**
+     * Parse a string, appending the decoded bytes to out
+     */
+    bool parse_string_into(string &out, char quote = '"')
+    {
+        size_t start = i;
+        const Kernels &k = kernels();
+        const char *end = str.data() + str.size();
+        // a single-quoted string ends on a byte the kernels don't stop at
+        const bool single = Syntax::single_quotes && quote == '\'';
+        // validating, the ASCII scan also stops at the first non-ASCII byte
+        const char *(*find_special)(const char *, const char *) =
+            Syntax::validate_utf8 ? k.find_ascii_escape : k.find_string_special;
+        while (true)
+        {
+            // copy the plain run up to the next quote, backslash or control byte,
+            // back-to-back escapes skip the kernel call
+            size_t run = single || str[i] == '\\' ? 0 : find_special(str.data() + i, end) - (str.data() + i);
+            if (Syntax::validate_utf8 && !single && i + run != str.size() && static_cast<uint8_t>(str[i + run]) >= 0x80)
+            {
+                // check the rest of the run in one go, it ends on an ASCII byte
+                // so no sequence is cut
+                size_t tail = k.find_string_special(str.data() + i + run, end) - (str.data() + i + run);
+                if (!k.validate_utf8(str.data() + i + run, tail))
+                    return fail("invalid UTF-8 in string", false);
+                run += tail;
+            }
+            if (run)
+            {
+                out.append(str, i, run);
+                i += run;
+            }
+
+            if (i == str.size())
+                return fail("unexpected end of input in string", false);
+
+            char ch = str[i++];
+
+            if (ch == (single ? '\'' : '"'))
+            {
+                JSONL_STAT(string_bytes, i - start);
+                return true;
+            }
+
+            if (in_range(ch, 0, 0x1f))
+                return fail("unescaped " + esc(ch) + " in string", false);
+
+            if (Syntax::validate_utf8 && static_cast<uint8_t>(ch) >= 0x80)
+            {
+                // single-quoted strings come through byte by byte
+                const unsigned char *p = reinterpret_cast<const unsigned char *>(str.data() + i - 1);
+                size_t length = utf8_sequence_length(p, reinterpret_cast<const unsigned char *>(end));
+                if (!length)
+                    return fail("invalid UTF-8 in string", false);
+                out.append(str, i - 1, length);
+                i += length - 1;
+                continue;
+            }
+
+            if (ch != '\\')
+            {
+                out += ch;
+                continue;
+            }
+
+            if (i == str.size())
+                return fail("unexpected end of input in string", false);
+
+            ch = str[i++];
+            JSONL_STAT(escapes, 1);
+
+            if (ch == 'u')
+            {
+                // decode a run of \u escapes into a local buffer, one append per run
+                char buf[64];
+                size_t n = 0;
+                while (true)
+                {
+                    long codepoint = decode_hex4(i);
+                    if (codepoint < 0)
+                        return fail("bad \\u escape: " + str.substr(i, 4), false);
+                    i += 4;
+
+                    // a high surrogate directly followed by a low one is one code point,
+                    // an unpaired one is encoded as is unless validating
+                    if (in_range(codepoint, 0xD800, 0xDBFF) && str.size() - i >= 6 && str[i] == '\\' && str[i + 1] == 'u')
+                    {
+                        long low = decode_hex4(i + 2);
+                        if (in_range(low, 0xDC00, 0xDFFF))
+                        {
+                            JSONL_STAT(escapes, 1);
+                            codepoint = (((codepoint - 0xD800) << 10) | (low - 0xDC00)) + 0x10000;
+                            i += 6;
+                        }
+                    }
+                    if (Syntax::validate_utf8 && in_range(codepoint, 0xD800, 0xDFFF))
+                        return fail("unpaired surrogate in \\u escape: " + str.substr(i - 6, 6), false);
+                    n += encode_utf8(codepoint, buf + n);
+
+                    if (n > sizeof buf - 4 || str.size() - i < 2 || str[i] != '\\' || str[i + 1] != 'u')
+                        break;
+                    i += 2;
+                    JSONL_STAT(escapes, 1);
+                }
+                out.append(buf, n);
+                continue;
+            }
+
+            switch (ch)
+            {
+            case 'b':
+                out += '\b';
+                break;
+            case 'f':
+                out += '\f';
+                break;
+            case 'n':
+                out += '\n';
+                break;
+            case 'r':
+                out += '\r';
+                break;
+            case 't':
+                out += '\t';
+                break;
+            case '"':
+            case '\\':
+            case '/':
+                out += ch;
+                break;
+            case '\'':
+                if (Syntax::single_quotes)
+                {
+                    out += ch;
+                    break;
+                }
+                return fail("invalid escape character " + esc(ch), false);
+            default:
+                return fail("invalid escape character " + esc(ch), false);
+            }
+        }
+    }
+
+    /**
+     * expect null true false
+     */
+    Json expect(const string &expected, Json res)
+    {
+        assert(i != 0);
+        size_t len = expected.length();
+        i--;
+        if (str.compare(i, len, expected) == 0)
+        {
+            i += len;
+            return res;
+        }
+        else
+        {
+            return fail("parse error : expected " + expected + ", got " + str.substr(i, len));
+        }
+    }
+
+    /**
+     * Parse a JSON object
+     */
+    /**
+     * Container being filled by parse_json
+     */
+    struct Frame
+    {
+        bool is_object;
+        vector<Json> array;
+        map<string, Json> object;
+        string key;
+        size_t node; // projection node of the container, if projecting
+    };
+
+    /**
+     * The packing array got something other than a number: its numbers
+     * become nodes in front of it.
+     */
+    void unpack(Frame &frame, vector<double> &numbers)
+    {
+        frame.array.reserve(numbers.size() + 1);
+        for (double value : numbers)
+        {
+            int int_value;
+            JSONL_STAT_NODE(JsonDouble, 0);
+            frame.array.push_back(exact_int(value, int_value) ? Json(int_value) : Json(value));
+        }
+        numbers.clear();
+    }
+
+    /**
+     * Parse an object key and its ':', ch is the token that opened it
+     */
+    bool parse_key(char ch, Frame &frame)
+    {
+        if (!starts_key(ch))
+            return fail("expected '\"' in object, got " + esc(ch), false);
+
+        // decode into the frame's own key, whose buffer is reused whenever
+        // the last member was skipped rather than stored
+        if (!Syntax::unquoted_keys || is_quote(ch))
+        {
+            frame.key.clear();
+            parse_string_into(frame.key, ch);
+        }
+        else
+        {
+            frame.key = parse_key_string(ch);
+        }
+        if (failed)
+            return false;
+
+        ch = get_next_token();
+        if (ch != ':')
+            return fail("expected ':' in object, got " + esc(ch), false);
+
+        JSONL_STAT(keys, 1);
+        return true;
+    }
+
+    /**
+     * Parse a number, literal or string, ch is its first character
+     */
+    Json parse_scalar(char ch)
+    {
+        if (ch == '-' || (ch >= '0' && ch <= '9'))
+        {
+            i--;
+            JSONL_STAT(numbers, 1);
+            if (lazy_numbers)
+                return parse_raw_number();
+            JSONL_STAT_NODE(JsonDouble, 0);
+            return parse_number();
+        }
+
+        if (ch == 'n')
+        {
+            JSONL_STAT(nulls, 1);
+            return expect("null", Json());
+        }
+
+        if (ch == 't')
+        {
+            JSONL_STAT(bools, 1);
+            return expect("true", true);
+        }
+
+        if (ch == 'f')
+        {
+            JSONL_STAT(bools, 1);
+            return expect("false", false);
+        }
+
+        if (is_quote(ch))
+        {
+            string value = parse_string(ch);
+            JSONL_STAT(strings, 1);
+            // payloads beyond the small-string buffer live on the heap
+            JSONL_STAT_NODE(JsonString, value.size() > 15 ? value.size() + 1 : 0);
+            return Json(move(value));
+        }
+
+        return fail("expected value, got " + esc(ch));
+    }
+
+    Json close_frame(Frame &frame, vector<double> &numbers)
+    {
+        if (frame.is_object)
+        {
+            JSONL_STAT(objects, 1);
+            JSONL_STAT_NODE(JsonObject, frame.object.size() * (sizeof(map<string, Json>::value_type) + 4 * sizeof(void *)));
+            return Json(move(frame.object));
+        }
+        JSONL_STAT(arrays, 1);
+        if (!numbers.empty())
+        {
+            // exactly sized, the scratch buffer stays for the next array
+            JSONL_STAT_NODE(JsonPackedArray, numbers.size() * sizeof(double));
+            vector<double> packed(numbers.begin(), numbers.end());
+            numbers.clear();
+            return JsonBuilder::wrap(make_shared<JsonPackedArray>(move(packed)));
+        }
+        JSONL_STAT_NODE(JsonArray, frame.array.capacity() * sizeof(Json));
+        return Json(move(frame.array));
+    }
+
+    /**
+     * Step over the value whose first byte was just read, depth containers
+     * deep, without building it. JsonValidator walks it, so skipped input is held to the
+     * same grammar as kept input. A value nested past the validator's fixed
+     * stack, but within depth_limit, is parsed and dropped instead.
+     */
+    void skip_value(size_t depth)
+    {
+        size_t start = i - 1;
+        size_t limit = std::min(depth_limit - depth, validate_depth_max - 1);
+        JsonValidateStats counts;
+        NullSink sink;
+        JsonValidator<Syntax> validator{str.data(), str.data() + str.size(), str.data() + start, err, false, counts,
+                                        limit, sink};
+        if (!validator.validate_json())
+        {
+            if (limit == depth_limit - depth || counts.max_depth < limit)
+            {
+                failed = true;
+                return;
+            }
+            err.clear();
+            JsonParser deep{str, start, err, false, nullptr, depth_limit - depth, false, false};
+            deep.parse_json();
+            if (deep.failed)
+            {
+                failed = true;
+                return;
+            }
+            validator.p = str.data() + deep.i;
+        }
+        i = validator.p - str.data();
+        JSONL_STAT(skipped_bytes, i - start);
+    }
+
+    /**
+     * Parse a JSON value. Open containers live on an explicit stack, the
+     * n-th entry holding the values at depth n + 1. With a projection only
+     * the containers leading to its paths and the values they end at are
+     * built, the rest goes through skip_value. With pack_numbers the
+     * innermost array collects numbers in a scratch buffer for as long as
+     * it holds nothing else.
+     */
+    template <bool projected = false>
+    Json parse_json(const JsonProjection *projection = nullptr)
+    {
+        vector<Frame> stack;
+        vector<double> numbers;
+        Json value;
+        // projection node of the value about to be read, and whether the
+        // last one was kept
+        size_t target = 0;
+        bool kept = true;
+        while (true)
+        {
+            size_t depth = stack.size();
+            if (depth > depth_limit)
+                return fail("exceeded maximum nesting depth");
+
+            JSONL_STAT_MAX(max_depth, depth);
+
+            char ch = get_next_token();
+            if (failed)
+                return Json();
+
+            kept = true;
+            bool packed = false;
+            if (projected && (target == JsonProjection::npos ||
+                              (!projection->keeps(target) && ch != '{' && ch != '[')))
+            {
+                skip_value(depth);
+                if (failed)
+                    return Json();
+                kept = false;
+            }
+            else if (ch == '{' || ch == '[')
+            {
+                if (!numbers.empty())
+                    unpack(stack.back(), numbers);
+                bool is_object = ch == '{';
+                ch = get_next_token();
+                if (ch == (is_object ? '}' : ']'))
+                {
+                    if (is_object)
+                    {
+                        JSONL_STAT(objects, 1);
+                        JSONL_STAT_NODE(JsonObject, 0);
+                        value = Json(map<string, Json>());
+                    }
+                    else
+                    {
+                        JSONL_STAT(arrays, 1);
+                        JSONL_STAT_NODE(JsonArray, 0);
+                        value = Json(vector<Json>());
+                    }
+                }
+                else
+                {
+                    if (stack.capacity() == 0)
+                        stack.reserve(32);
+                    stack.emplace_back();
+                    Frame &top = stack.back();
+                    top.is_object = is_object;
+                    top.node = target;
+                    if (!is_object)
+                    {
+                        i--;
+                        if (projected)
+                            target = projection->element(top.node);
+                    }
+                    else
+                    {
+                        if (!parse_key(ch, top))
+                            return Json();
+                        if (projected)
+                            target = projection->child(top.node, top.key);
+                    }
+                    continue;
+                }
+            }
+            else if (pack_numbers && depth && !stack.back().is_object && stack.back().array.empty() &&
+                     (ch == '-' || in_range(ch, '0', '9')))
+            {
+                // straight into the array's packed numbers, no node
+                i--;
+                Number num;
+                if (!scan_number(num))
+                    return Json();
+                JSONL_STAT(numbers, 1);
+                numbers.push_back(num.is_int ? num.int_value : num.double_value);
+                packed = true;
+            }
+            else
+            {
+                value = parse_scalar(ch);
+                if (failed)
+                    return Json();
+            }
+
+            // store the finished value, closing every container it completes
+            while (true)
+            {
+                if (stack.empty())
+                    return value;
+
+                Frame &top = stack.back();
+                if (top.is_object)
+                {
+                    if (!projected || kept)
+                        top.object[move(top.key)] = move(value);
+                    ch = get_next_token();
+                    if (ch != '}')
+                    {
+                        if (ch != ',')
+                            return fail("expected ',' in object, got " + esc(ch));
+                        ch = get_next_token();
+                        if (!Syntax::trailing_commas || ch != '}')
+                        {
+                            if (!parse_key(ch, top))
+                                return Json();
+                            if (projected)
+                                target = projection->child(top.node, top.key);
+                            break;
+                        }
+                    }
+                }
+                else
+                {
+                    if (!packed && (!projected || kept))
+                    {
+                        if (!numbers.empty())
+                            unpack(top, numbers);
+                        top.array.push_back(move(value));
+                    }
+                    ch = get_next_token();
+                    if (ch != ']')
+                    {
+                        if (ch != ',')
+                            return fail("expected ',' in list, got " + esc(ch));
+                        ch = get_next_token();
+                        if (!Syntax::trailing_commas || ch != ']')
+                        {
+                            i--;
+                            if (projected)
+                                target = projection->element(top.node);
+                            break;
+                        }
+                    }
+                }
+                value = close_frame(top, numbers);
+                stack.pop_back();
+                kept = true;
+                packed = false;
+            }
+        }
+    }
+
+    /**
+     * Tape container still open in parse_tape
+     */
+    struct TapeFrame
+    {
+        bool is_object;
+        size_t open; // index of the open word
+        uint64_t count;
+    };
+
+    /**
+     * Parse a JSON value onto a tape, see JsonTape. Same loop as parse_json,
+     * open containers live on an explicit stack.
+     */
+    void parse_tape(vector<uint64_t> &tape, string &strings)
+    {
+        vector<TapeFrame> stack;
+        while (true)
+        {
+            if (stack.size() > depth_limit)
+            {
+                fail("exceeded maximum nesting depth");
+                return;
+            }
+
+            char ch = get_next_token();
+            if (failed)
+                return;
+
+            if (ch == '{' || ch == '[')
+            {
+                bool is_object = ch == '{';
+                TapeFrame frame{is_object, tape.size(), 0};
+                tape.push_back(0);
+                ch = get_next_token();
+                if (ch != (is_object ? '}' : ']'))
+                {
+                    if (stack.capacity() == 0)
+                        stack.reserve(32);
+                    stack.push_back(frame);
+                    if (!is_object)
+                        i--;
+                    else if (!parse_tape_key(tape, strings, ch))
+                        return;
+                    continue;
+                }
+                if (!close_tape_container(tape, frame))
+                    return;
+            }
+            else if (!parse_tape_scalar(tape, strings, ch))
+            {
+                return;
+            }
+
+            // count the finished value, closing every container it completes
+            while (true)
+            {
+                if (stack.empty())
+                    return;
+
+                TapeFrame &top = stack.back();
+                top.count++;
+                char close = top.is_object ? '}' : ']';
+                ch = get_next_token();
+                if (ch != close)
+                {
+                    if (ch != ',')
+                    {
+                        fail((top.is_object ? "expected ',' in object, got " : "expected ',' in list, got ") + esc(ch));
+                        return;
+                    }
+                    ch = get_next_token();
+                    if (!Syntax::trailing_commas || ch != close)
+                    {
+                        if (!top.is_object)
+                            i--;
+                        else if (!parse_tape_key(tape, strings, ch))
+                            return;
+                        break;
+                    }
+                }
+                if (!close_tape_container(tape, top))
+                    return;
+                stack.pop_back();
+            }
+        }
+    }
+
+    /**
+     * Put a number, literal or string on the tape, ch is its first character
+     */
+    bool parse_tape_scalar(vector<uint64_t> &tape, string &strings, char ch)
+    {
+        if (ch == '-' || (ch >= '0' && ch <= '9'))
+        {
+            i--;
+            Number num;
+            if (!scan_number(num))
+                return false;
+            if (num.is_int)
+            {
+                tape.push_back(tape_word(TAPE_INT, static_cast<uint32_t>(num.int_value)));
+            }
+            else
+            {
+                uint64_t bits;
+                memcpy(&bits, &num.double_value, sizeof bits);
+                tape.push_back(tape_word(TAPE_DOUBLE, 0));
+                tape.push_back(bits);
+            }
+            return true;
+        }
+
+        if (ch == 'n')
+        {
+            expect("null", Json());
+            tape.push_back(tape_word(TAPE_NUL, 0));
+            return !failed;
+        }
+
+        if (ch == 't')
+        {
+            expect("true", true);
+            tape.push_back(tape_word(TAPE_TRUE, 0));
+            return !failed;
+        }
+
+        if (ch == 'f')
+        {
+            expect("false", false);
+            tape.push_back(tape_word(TAPE_FALSE, 0));
+            return !failed;
+        }
+
+        if (is_quote(ch))
+            return parse_tape_string(tape, strings, ch);
+
+        return fail("expected value, got " + esc(ch), false);
+    }
+
+    /**
+     * Append a string as <u32 length><bytes>'\0' and push its offset
+     */
+    bool parse_tape_string(vector<uint64_t> &tape, string &strings, char quote = '"')
+    {
+        size_t offset = strings.size();
+        strings.append(sizeof(uint32_t), '\0');
+        if (!parse_string_into(strings, quote))
+            return false;
+        return finish_tape_string(tape, strings, offset);
+    }
+
+    /**
+     * Parse an object key and its ':' onto the tape, ch is the token that
+     * opened it
+     */
+    bool parse_tape_key(vector<uint64_t> &tape, string &strings, char ch)
+    {
+        if (!starts_key(ch))
+            return fail("expected '\"' in object, got " + esc(ch), false);
+
+        if (!Syntax::unquoted_keys || is_quote(ch))
+        {
+            if (!parse_tape_string(tape, strings, ch))
+                return false;
+        }
+        else
+        {
+            size_t offset = strings.size();
+            strings.append(sizeof(uint32_t), '\0');
+            strings += parse_key_string(ch);
+            if (failed || !finish_tape_string(tape, strings, offset))
+                return false;
+        }
+
+        ch = get_next_token();
+        if (ch != ':')
+            return fail("expected ':' in object, got " + esc(ch), false);
+        return true;
+    }
+
+    bool finish_tape_string(vector<uint64_t> &tape, string &strings, size_t offset)
+    {
+        size_t length = strings.size() - offset - sizeof(uint32_t);
+        if (length > tape_index_max)
+            return fail("string too long for a tape", false);
+        uint32_t length32 = static_cast<uint32_t>(length);
+        memcpy(&strings[offset], &length32, sizeof length32);
+        strings += '\0';
+        tape.push_back(tape_word(TAPE_STRING, offset));
+        return true;
+    }
+
+    /**
+     * Open word: count in bits 32..55, index past the closing word below.
+     * Close word: index of the open word. Documents whose tape outgrows
+     * the 32-bit index fail rather than wrap.
+     */
+    bool close_tape_container(vector<uint64_t> &tape, const TapeFrame &frame)
+    {
+        tape.push_back(tape_word(frame.is_object ? TAPE_OBJECT_END : TAPE_ARRAY_END, frame.open));
+        if (tape.size() > tape_index_max)
+            return fail("document too large for a tape", false);
+        uint64_t count = std::min(frame.count, tape_count_max);
+        tape[frame.open] = tape_word(frame.is_object ? TAPE_OBJECT : TAPE_ARRAY, (count << 32) | tape.size());
+        return true;
+    }
+};
+
+/**
+ * JsonParser's grammar over a byte range, building nothing. The input need
+ * not be NUL terminated, so every read is bounds checked. Tokens go to the
+ * sink as they are accepted.
+ */
+template <class Syntax, class Sink>
+struct JsonValidator final
+{
+    const char *const begin;
+    const char *const end;
+    const char *p;
+    string &err;
+    bool failed;
+    JsonValidateStats &stats;
+    const size_t depth_limit;
+    Sink &sink;
+
+    bool fail(string &&msg)
+    {
+        if (!failed)
+            err = std::move(msg);
+        failed = true;
+        return false;
+    }
+
+    // the byte at p, 0 past the end like the parser's terminator
+    char peek() const
+    {
+        return p != end ? *p : 0;
+    }
+
+    // the four hex digits at q as one UTF-16 unit, -1 if short or not hex
+    long hex4(const char *q) const
+    {
+        if (end - q < 4)
+            return -1;
+        const unsigned char *hex = reinterpret_cast<const unsigned char *>(q);
+        int d0 = hex_digits[hex[0]], d1 = hex_digits[hex[1]], d2 = hex_digits[hex[2]], d3 = hex_digits[hex[3]];
+        if ((d0 | d1 | d2 | d3) < 0)
+            return -1;
+        return (d0 << 12) | (d1 << 8) | (d2 << 4) | d3;
+    }
+
+    bool consume_comment()
+    {
+        if (peek() != '/')
+            return false;
+        if (++p == end)
+            return fail("unexpected end of input after start of comment");
+        if (*p == '/')
+        {
+            p = static_cast<const char *>(memchr(p, '\n', end - p));
+            if (!p)
+                p = end;
+            return true;
+        }
+        if (*p != '*')
+            return fail("malformed comment");
+        for (++p; end - p >= 2; ++p)
+        {
+            if (p[0] == '*' && p[1] == '/')
+            {
+                p += 2;
+                return true;
+            }
+        }
+        return fail("unexpected end of input inside multi-line comment");
+    }
+
+    void consume_whitespace()
+    {
+        if (p != end && is_space(*p))
+            p = kernels().skip_space(p, end);
+    }
+
+    void consume_garbage()
+    {
+        consume_whitespace();
+        if (Syntax::comments)
+        {
+            while (consume_comment())
+                consume_whitespace();
+        }
+    }
+
+    char get_next_token()
+    {
+        consume_garbage();
+        if (failed)
+            return 0;
+        if (p == end)
+        {
+            fail("unexpected end of input");
+            return 0;
+        }
+        return *p++;
+    }
+
+    bool scan_number()
+    {
+        const char *start = p;
+        if (peek() == '-')
+            p++;
+
+        if (peek() == '0')
+        {
+            p++;
+            if (in_range(peek(), '0', '9'))
+                return fail("leading 0s not permitted in numbers");
+        }
+        else if (in_range(peek(), '1', '9'))
+            p = kernels().skip_digits(p + 1, end);
+        else
+            return fail("invalid " + esc(peek()) + "in number");
+
+        if (peek() == '.')
+        {
+            p++;
+            if (!in_range(peek(), '0', '9'))
+                return fail("at least one digit required in fractional part");
+            p = kernels().skip_digits(p, end);
+        }
+
+        if (peek() == 'e' || peek() == 'E')
+        {
+            p++;
+            if (peek() == '+' || peek() == '-')
+                p++;
+            if (!in_range(peek(), '0', '9'))
+                return fail("at least one digit required in exponent");
+            p = kernels().skip_digits(p, end);
+        }
+        sink.scalar(start, p);
+        return true;
+    }
+
+    bool scan_string(char quote)
+    {
+        const char *start = p;
+        const Kernels &k = kernels();
+        const bool single = Syntax::single_quotes && quote == '\'';
+        // same scan as JsonParser::parse_string_into
+        const char *(*find_special)(const char *, const char *) =
+            Syntax::validate_utf8 ? k.find_ascii_escape : k.find_string_special;
+        while (true)
+        {
+            if (!single)
+                p = find_special(p, end);
+            if (Syntax::validate_utf8 && !single && p != end && static_cast<uint8_t>(*p) >= 0x80)
+            {
+                const char *tail = k.find_string_special(p, end);
+                if (!k.validate_utf8(p, tail - p))
+                    return fail("invalid UTF-8 in string");
+                p = tail;
+            }
+            if (p == end)
+                return fail("unexpected end of input in string");
+
+            char ch = *p++;
+            if (ch == (single ? '\'' : '"'))
+            {
+                sink.string_literal(start, p - 1, quote);
+                return true;
+            }
+
+            if (in_range(ch, 0, 0x1f))
+                return fail("unescaped " + esc(ch) + " in string");
+            if (Syntax::validate_utf8 && static_cast<uint8_t>(ch) >= 0x80)
+            {
+                size_t length = utf8_sequence_length(reinterpret_cast<const unsigned char *>(p - 1),
+                                                     reinterpret_cast<const unsigned char *>(end));
+                if (!length)
+                    return fail("invalid UTF-8 in string");
+                p += length - 1;
+                continue;
+            }
+            if (ch != '\\')
+                continue;
+
+            if (p == end)
+                return fail("unexpected end of input in string");
+            ch = *p++;
+            if (ch == 'u')
+            {
+                long unit = hex4(p);
+                if (unit < 0)
+                    return fail("bad \\u escape: " + string(p, std::min<size_t>(4, end - p)));
+                p += 4;
+                if (Syntax::validate_utf8 && in_range(unit, 0xD800, 0xDFFF))
+                {
+                    // only a high surrogate directly followed by a low one is a code point
+                    long low = unit <= 0xDBFF && end - p >= 6 && p[0] == '\\' && p[1] == 'u' ? hex4(p + 2) : -1;
+                    if (!in_range(low, 0xDC00, 0xDFFF))
+                        return fail("unpaired surrogate in \\u escape: " + string(p - 6, 6));
+                    p += 6;
+                }
+                continue;
+            }
+            switch (ch)
+            {
+            case 'b':
+            case 'f':
+            case 'n':
+            case 'r':
+            case 't':
+            case '"':
+            case '\\':
+            case '/':
+                break;
+            case '\'':
+                if (Syntax::single_quotes)
+                    break;
+                return fail("invalid escape character " + esc(ch));
+            default:
+                return fail("invalid escape character " + esc(ch));
+            }
+        }
+    }
+
+    bool scan_key(char ch)
+    {
+        if (Syntax::unquoted_keys && !JsonParser<Syntax>::is_quote(ch) && JsonParser<Syntax>::starts_key(ch))
+        {
+            const char *start = p - 1;
+            while (p != end && JsonParser<Syntax>::is_identifier(*p))
+                p++;
+            sink.string_literal(start, p, 0);
+        }
+        else if (!JsonParser<Syntax>::starts_key(ch))
+            return fail("expected '\"' in object, got " + esc(ch));
+        else if (!scan_string(ch))
+            return false;
+
+        ch = get_next_token();
+        if (ch != ':')
+            return fail("expected ':' in object, got " + esc(ch));
+        sink.colon();
+        stats.keys++;
+        return true;
+    }
+
+    bool expect(const char *expected, size_t len)
+    {
+        p--;
+        if (static_cast<size_t>(end - p) >= len && memcmp(p, expected, len) == 0)
+        {
+            sink.scalar(p, p + len);
+            p += len;
+            return true;
+        }
+        return fail("parse error : expected " + string(expected) + ", got " +
+                    string(p, std::min<size_t>(len, end - p)));
+    }
+
+    bool scan_scalar(char ch)
+    {
+        if (ch == '-' || (ch >= '0' && ch <= '9'))
+        {
+            p--;
+            stats.numbers++;
+            return scan_number();
+        }
+        if (ch == 'n')
+        {
+            stats.nulls++;
+            return expect("null", 4);
+        }
+        if (ch == 't')
+        {
+            stats.bools++;
+            return expect("true", 4);
+        }
+        if (ch == 'f')
+        {
+            stats.bools++;
+            return expect("false", 5);
+        }
+        if (JsonParser<Syntax>::is_quote(ch))
+        {
+            stats.strings++;
+            return scan_string(ch);
+        }
+        return fail("expected value, got " + esc(ch));
+    }
+
+    void count_container(bool is_object)
+    {
+        if (is_object)
+            stats.objects++;
+        else
+            stats.arrays++;
+    }
+
+    /**
+     * Same walk as JsonParser::parse_json, the stack reduced to one bit
+     * per open container
+     */
+    bool validate_json()
+    {
+        // bit n set when the container at depth n + 1 is an object
+        uint64_t objects[validate_depth_max / 64];
+        size_t depth = 0;
+        while (true)
+        {
+            if (depth > depth_limit)
+                return fail("exceeded maximum nesting depth");
+            stats.max_depth = std::max(stats.max_depth, depth);
+
+            char ch = get_next_token();
+            if (failed)
+                return false;
+
+            if (ch == '{' || ch == '[')
+            {
+                bool is_object = ch == '{';
+                sink.open(ch);
+                ch = get_next_token();
+                if (ch == (is_object ? '}' : ']'))
+                {
+                    sink.close(ch, true);
+                    count_container(is_object);
+                }
+                else
+                {
+                    uint64_t bit = uint64_t(1) << (depth % 64);
+                    objects[depth / 64] = is_object ? objects[depth / 64] | bit : objects[depth / 64] & ~bit;
+                    depth++;
+                    sink.separator(true);
+                    if (!is_object)
+                        p--;
+                    else if (!scan_key(ch))
+                        return false;
+                    continue;
+                }
+            }
+            else if (!scan_scalar(ch))
+            {
+                return false;
+            }
+
+            // close every container the value completes
+            while (true)
+            {
+                if (depth == 0)
+                    return true;
+
+                bool is_object = (objects[(depth - 1) / 64] >> ((depth - 1) % 64)) & 1;
+                char close = is_object ? '}' : ']';
+                ch = get_next_token();
+                if (ch != close)
+                {
+                    if (ch != ',')
+                        return fail((is_object ? "expected ',' in object, got " : "expected ',' in list, got ") + esc(ch));
+                    ch = get_next_token();
+                    if (!Syntax::trailing_commas || ch != close)
+                    {
+                        sink.separator(false);
+                        if (!is_object)
+                            p--;
+                        else if (!scan_key(ch))
+                            return false;
+                        break;
+                    }
+                }
+                sink.close(close, false);
+                count_container(is_object);
+                depth--;
+            }
+        }
+    }
+};
+
 /**
- * Accessors
+ * Writes the tokens back out through a JsonWriter layout. Number and
+ * literal text is copied as is; relaxed strings and keys come out double
+ * quoted, without the \' escape Syntax may allow in either quote style.
  */
-Json::Type Json::type() const { return m_ptr->type(); }
-double Json::number_value() const { return m_ptr->number_value(); }
-int Json::int_value() const { return m_ptr->int_value(); }
-bool Json::bool_value() const { return m_ptr->bool_value(); }
-const string &Json::string_value() const { return m_ptr->string_value(); }
-const vector<Json> &Json::array_items() const { return m_ptr->array_items(); }
-const map<string, Json> &Json::object_items() const { return m_ptr->object_items(); }
+template <class Syntax, class Layout>
+struct ReformatSink
+{
+    string &out;
+    Layout layout;
+    bool ascii_only;
 
-const Json &Json::operator[](size_t i) const { return (*m_ptr)[i]; }
-const Json &Json::operator[](const string &key) const { return (*m_ptr)[key]; }
+    void open(char ch) { layout.open(out, ch); }
+    void close(char ch, bool empty) { layout.close(out, ch, empty); }
+    void separator(bool first)
+    {
+        if (first)
+            layout.first(out);
+        else
+            layout.next(out);
+    }
+    void colon() { layout.key(out); }
+    void scalar(const char *begin, const char *end) { out.append(begin, end - begin); }
 
-double JsonValue::number_value() const { return 0; }
-int JsonValue::int_value() const { return 0; }
-bool JsonValue::bool_value() const { return false; }
-const string &JsonValue::string_value() const { return statics().empty_string; }
-const Json::array &JsonValue::array_items() const { return statics().empty_vector; }
-const Json &JsonValue::operator[](size_t i) const { return static_null(); }
-const Json::object &JsonValue::object_items() const { return statics().empty_map; }
-const Json &JsonValue::operator[](const string &key) const { return static_null(); }
+    void string_literal(const char *begin, const char *end, char)
+    {
+        out += '"';
+        if (!Syntax::single_quotes && !ascii_only)
+        {
+            // already valid inside double quotes
+            out.append(begin, end - begin);
+            out += '"';
+            return;
+        }
 
-const Json &JsonArray::operator[](size_t i) const
+        const Kernels &k = kernels();
+        const char *(*find)(const char *, const char *) = ascii_only ? k.find_ascii_escape : k.find_string_special;
+        while (begin != end)
+        {
+            const char *stop = find(begin, end);
+            out.append(begin, stop - begin);
+            if (stop == end)
+                break;
+            begin = stop;
+            if (static_cast<uint8_t>(*begin) >= 0x80)
+            {
+                begin += dump_unicode_escaped(begin, end - begin, out);
+            }
+            else if (*begin == '\\')
+            {
+                // \' is not standard JSON, the rest carry over
+                if (begin[1] == '\'')
+                    out += '\'';
+                else
+                    out.append(begin, 2);
+                begin += 2;
+            }
+            else
+            {
+                // a '"' inside single quotes
+                out += "\\\"";
+                begin++;
+            }
+        }
+        out += '"';
+    }
+};
+
+} // namespace
+
+/**
+ * One document, with nothing but whitespace (and comments) after it
+ */
+template <class Syntax>
+static Json parse_checked(const string &in, string &err, const JsonParseOptions &options, JsonParseStats *stats, bool &failed)
 {
-    if (i >= m_value.size())
-        return static_null();
-    else
-        return m_value[i];
+    JsonParser<Syntax> parser{in, 0, err, false, stats, options.max_depth, options.lazy_numbers,
+                               options.pack_numbers && !options.lazy_numbers};
+    Json result = options.projection ? parser.template parse_json<true>(options.projection) : parser.parse_json();
+
+    parser.consume_garbage();
+    if (parser.failed)
+        result = Json();
+    else if (parser.i != in.size())
+        result = parser.fail("unexpected trailing " + esc(in[parser.i]));
+    failed = parser.failed;
+    return result;
 }
 
-const Json &JsonObject::operator[](const string &key) const
+template <class Syntax>
+static Json parse_document(const string &in, string &err, const JsonParseOptions &options, JsonParseStats *stats, bool &failed)
 {
-    auto iter = m_value.find(key);
-    return (iter == m_value.end()) ? static_null() : iter->second;
+    if (options.validate_utf8)
+        return parse_checked<Utf8Syntax<Syntax>>(in, err, options, stats, failed);
+    return parse_checked<Syntax>(in, err, options, stats, failed);
 }
 
-/**
- * Comparison
- */
+template <class Syntax>
+static vector<Json> parse_documents(const string &in, string::size_type &parser_stop_pos, string &err,
+                                    const JsonParseOptions &options, bool &failed)
+{
+    JsonParser<Syntax> parser{in, 0, err, false, nullptr, options.max_depth, options.lazy_numbers,
+                               options.pack_numbers && !options.lazy_numbers};
+    parser_stop_pos = 0;
+    vector<Json> json_vec;
+    while (parser.i != in.size() && !parser.failed)
+    {
+        json_vec.push_back(options.projection ? parser.template parse_json<true>(options.projection) : parser.parse_json());
+        if (parser.failed)
+            break;
+        parser.consume_garbage();
+        if (parser.failed)
+            break;
+        parser_stop_pos = parser.i;
+    }
+    failed = parser.failed;
+    return json_vec;
+}
 
-bool Json::operator==(const Json &other) const
+template <class Syntax>
+static vector<Json> parse_multi_documents(const string &in, string::size_type &parser_stop_pos, string &err,
+                                          const JsonParseOptions &options, bool &failed)
 {
-    if (m_ptr == other.m_ptr)
-        return true;
-    if (m_ptr->type() != other.m_ptr->type())
+    if (options.validate_utf8)
+        return parse_documents<Utf8Syntax<Syntax>>(in, parser_stop_pos, err, options, failed);
+    return parse_documents<Syntax>(in, parser_stop_pos, err, options, failed);
+}
+
+Json Json::parse(const std::string &in,
+                    std::string &err,
+                    const JsonParseOptions &options)
+{
+    JsonParseStats *stats = options.stats;
+#ifdef JSONL_PARSE_STATS
+    if (stats)
+    {
+        *stats = JsonParseStats();
+        stats->enabled = true;
+    }
+    auto start = std::chrono::steady_clock::now();
+#else
+    if (stats)
+        *stats = JsonParseStats();
+    stats = nullptr;
+#endif
+
+    JSONL_PROBE1(parse__start, in.size());
+    bool failed = false;
+    Json result;
+    switch (options.strategy)
+    {
+    case JsonParse::STANDARD:
+        result = parse_document<StandardSyntax>(in, err, options, stats, failed);
+        break;
+    case JsonParse::COMMENTS:
+        result = parse_document<CommentSyntax>(in, err, options, stats, failed);
+        break;
+    case JsonParse::RELAXED:
+        result = parse_document<RelaxedSyntax>(in, err, options, stats, failed);
+        break;
+    }
+#ifdef JSONL_PARSE_STATS
+    if (stats)
+        stats->parse_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+#endif
+
+    JSONL_PROBE3(parse__done, in.size(), static_cast<int>(result.type()), static_cast<int>(failed));
+    return result;
+}
+
+std::vector<Json> Json::parse_multi(const std::string &in,
+                                    std::string::size_type &parser_stop_pos,
+                                    std::string &err,
+                                    const JsonParseOptions &options)
+{
+    JSONL_PROBE1(parse_multi__start, in.size());
+    bool failed = false;
+    vector<Json> json_vec;
+    switch (options.strategy)
+    {
+    case JsonParse::STANDARD:
+        json_vec = parse_multi_documents<StandardSyntax>(in, parser_stop_pos, err, options, failed);
+        break;
+    case JsonParse::COMMENTS:
+        json_vec = parse_multi_documents<CommentSyntax>(in, parser_stop_pos, err, options, failed);
+        break;
+    case JsonParse::RELAXED:
+        json_vec = parse_multi_documents<RelaxedSyntax>(in, parser_stop_pos, err, options, failed);
+        break;
+    }
+    JSONL_PROBE3(parse_multi__done, in.size(), json_vec.size(), static_cast<int>(failed));
+    return json_vec;
+}
+
+template <class Syntax>
+static bool validate_checked(const char *in, size_t size, string &err, JsonValidateStats &stats, size_t depth_limit)
+{
+    NullSink sink;
+    JsonValidator<Syntax> validator{in, in + size, in, err, false, stats, depth_limit, sink};
+    if (validator.validate_json())
+    {
+        validator.consume_garbage();
+        if (!validator.failed && validator.p != validator.end)
+            validator.fail("unexpected trailing " + esc(*validator.p));
+    }
+    return !validator.failed;
+}
+
+template <class Syntax>
+static bool validate_document(const char *in, size_t size, string &err, JsonValidateStats &stats, const JsonParseOptions &options)
+{
+    size_t depth_limit = std::min(options.max_depth, validate_depth_max - 1);
+    if (options.validate_utf8)
+        return validate_checked<Utf8Syntax<Syntax>>(in, size, err, stats, depth_limit);
+    return validate_checked<Syntax>(in, size, err, stats, depth_limit);
+}
+
+template <class Syntax, class Layout>
+static bool reformat_checked(const char *in, size_t size, string &out, string &err, Layout layout, bool ascii_only,
+                             size_t depth_limit)
+{
+    JsonValidateStats stats;
+    ReformatSink<Syntax, Layout> sink{out, layout, ascii_only};
+    JsonValidator<Syntax, ReformatSink<Syntax, Layout>> validator{in, in + size, in, err, false, stats, depth_limit, sink};
+    if (validator.validate_json())
+    {
+        validator.consume_garbage();
+        if (!validator.failed && validator.p != validator.end)
+            validator.fail("unexpected trailing " + esc(*validator.p));
+    }
+    return !validator.failed;
+}
+
+template <class Syntax>
+static bool reformat_styled(const char *in, size_t size, string &out, string &err, const JsonFormat &format,
+                            size_t depth_limit)
+{
+    switch (format.style)
+    {
+    case JsonFormat::Style::MINIFIED:
+        return reformat_checked<Syntax>(in, size, out, err, MinifiedLayout(), format.ascii_only, depth_limit);
+    case JsonFormat::Style::PRETTY:
+        return reformat_checked<Syntax>(in, size, out, err, PrettyLayout(format.indent, format.indent_char),
+                                        format.ascii_only, depth_limit);
+    default:
+        return reformat_checked<Syntax>(in, size, out, err, StandardLayout(), format.ascii_only, depth_limit);
+    }
+}
+
+template <class Syntax>
+static bool reformat_document(const char *in, size_t size, string &out, string &err, const JsonFormat &format,
+                              const JsonParseOptions &options)
+{
+    size_t depth_limit = std::min(options.max_depth, validate_depth_max - 1);
+    if (options.validate_utf8)
+        return reformat_styled<Utf8Syntax<Syntax>>(in, size, out, err, format, depth_limit);
+    return reformat_styled<Syntax>(in, size, out, err, format, depth_limit);
+}
+
+bool Json::validate(const char *in, size_t size, std::string &err, const JsonParseOptions &options)
+{
+    JsonValidateStats stats;
+    return validate(in, size, err, stats, options);
+}
+
+bool Json::validate(const char *in, size_t size, std::string &err, JsonValidateStats &stats, const JsonParseOptions &options)
+{
+    stats = JsonValidateStats();
+    if (!in)
+    {
+        err = "null input";
         return false;
-    return m_ptr->equals(other.m_ptr.get());
+    }
+
+    JSONL_PROBE1(validate__start, size);
+    bool valid = false;
+    switch (options.strategy)
+    {
+    case JsonParse::STANDARD:
+        valid = validate_document<StandardSyntax>(in, size, err, stats, options);
+        break;
+    case JsonParse::COMMENTS:
+        valid = validate_document<CommentSyntax>(in, size, err, stats, options);
+        break;
+    case JsonParse::RELAXED:
+        valid = validate_document<RelaxedSyntax>(in, size, err, stats, options);
+        break;
+    }
+    JSONL_PROBE2(validate__done, size, static_cast<int>(valid));
+    return valid;
 }
 
-bool Json::operator<(const Json &other) const
+bool Json::reformat(const char *in, size_t size, std::string &out, std::string &err, const JsonFormat &format,
+                    const JsonParseOptions &options)
 {
-    if (m_ptr == other.m_ptr)
+    if (!in)
+    {
+        err = "null input";
         return false;
-    if (m_ptr->type() != other.m_ptr->type())
-        return m_ptr->type() < other.m_ptr->type();
-    return m_ptr->less(other.m_ptr.get());
+    }
+
+    JSONL_PROBE1(reformat__start, size);
+    size_t start = out.size();
+    bool valid = false;
+    switch (options.strategy)
+    {
+    case JsonParse::STANDARD:
+        valid = reformat_document<StandardSyntax>(in, size, out, err, format, options);
+        break;
+    case JsonParse::COMMENTS:
+        valid = reformat_document<CommentSyntax>(in, size, out, err, format, options);
+        break;
+    case JsonParse::RELAXED:
+        valid = reformat_document<RelaxedSyntax>(in, size, out, err, format, options);
+        break;
+    }
+    if (!valid)
+        out.resize(start);
+    JSONL_PROBE2(reformat__done, out.size() - start, static_cast<int>(valid));
+    return valid;
 }
 
 /**
- * Parse
+ * Projection trie. A named child starts as a copy of the "*" child and
+ * every later "*" path is added to the named ones too, so a lookup never
+ * has to follow both.
  */
+const size_t JsonProjection::npos;
 
-static inline string esc(char c)
+void JsonProjection::add(const std::string &path)
 {
-    char buf[12];
-    if (static_cast<uint8_t>(c) >= 0x20 && static_cast<uint8_t>(c) <= 0x7f)
+    vector<string> steps;
+    for (size_t start = 0; !path.empty();)
     {
-        snprintf(buf, sizeof buf, "'%c' (%d)", c, c);
+        size_t dot = path.find('.', start);
+        steps.push_back(path.substr(start, dot == string::npos ? string::npos : dot - start));
+        if (dot == string::npos)
+            break;
+        start = dot + 1;
+    }
+    insert(0, steps, 0);
+}
+
+void JsonProjection::insert(size_t node, const vector<string> &steps, size_t step)
+{
+    if (m_nodes[node].whole)
+        return;
+    if (step == steps.size())
+    {
+        m_nodes[node].whole = true;
+        return;
+    }
+
+    const string &key = steps[step];
+    if (key == "*")
+    {
+        if (m_nodes[node].any == npos)
+        {
+            m_nodes.emplace_back();
+            m_nodes[node].any = m_nodes.size() - 1;
+        }
+        insert(m_nodes[node].any, steps, step + 1);
+        vector<size_t> named;
+        for (const auto &item : m_nodes[node].children)
+            named.push_back(item.second);
+        for (size_t next : named)
+            insert(next, steps, step + 1);
+        return;
+    }
+
+    size_t next;
+    auto found = m_nodes[node].children.find(key);
+    if (found != m_nodes[node].children.end())
+    {
+        next = found->second;
     }
     else
     {
-        snprintf(buf, sizeof buf, "(%d)", c);
+        if (m_nodes[node].any != npos)
+        {
+            next = clone(m_nodes[node].any);
+        }
+        else
+        {
+            m_nodes.emplace_back();
+            next = m_nodes.size() - 1;
+        }
+        m_nodes[node].children[key] = next;
     }
-    return string(buf);
+    insert(next, steps, step + 1);
+}
+
+size_t JsonProjection::clone(size_t node)
+{
+    Node source = m_nodes[node];
+    m_nodes.emplace_back();
+    size_t copy = m_nodes.size() - 1;
+    m_nodes[copy].whole = source.whole;
+    if (source.any != npos)
+    {
+        size_t any = clone(source.any);
+        m_nodes[copy].any = any;
+    }
+    for (const auto &item : source.children)
+    {
+        size_t next = clone(item.second);
+        m_nodes[copy].children[item.first] = next;
+    }
+    return copy;
+}
+
+size_t JsonProjection::child(size_t node, const std::string &key) const
+{
+    const Node &current = m_nodes[node];
+    if (current.whole)
+        return node;
+    auto found = current.children.find(key);
+    return found != current.children.end() ? found->second : current.any;
+}
+
+size_t JsonProjection::element(size_t node) const
+{
+    return m_nodes[node].whole ? node : m_nodes[node].any;
+}
+
+bool Json::has_shape(const shape &types, std::string &err) const
+{
+    if (!is_object())
+    {
+        err = "expected JSON object, got " + dump();
+        return false;
+    }
+
+    const auto &obj_items = object_items();
+    for (auto &item : types)
+    {
+        const auto it = obj_items.find(item.first);
+        if (it == obj_items.cend() || it->second.type() != item.second)
+        {
+            err = "bad type for " + item.first + "in" + dump();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+Json Json::parse_from_file(const std::string &filename,
+                            string &err,
+                            JsonParse strategy)
+{
+    JSONL_PROBE1(parse_from_file__start, filename.c_str());
+    ifstream fin(filename);
+    if (!fin.is_open())
+    {
+        err = "can not open the file";
+        JSONL_PROBE3(parse_from_file__done, size_t(0), static_cast<int>(Type::NUL), 1);
+        return Json();
+    }
+    std::stringstream buffer;
+    buffer << fin.rdbuf();
+    string in = buffer.str();
+    fin.close();
+    Json result = parse(in, err, strategy);
+    JSONL_PROBE3(parse_from_file__done, in.size(), static_cast<int>(result.type()), static_cast<int>(!err.empty()));
+    return result;
+}
+
+void Json::dump_to_file(const std::string &filename) const
+{
+    JSONL_PROBE1(dump_to_file__start, filename.c_str());
+    ofstream fout(filename);
+    if (!fout.is_open())
+    {
+        std::cout << "can not open the file" << std::endl;
+        JSONL_PROBE2(dump_to_file__done, size_t(0), 1);
+        return;
+    }
+    string out = this->dump();
+    fout << out;
+    fout.close();
+    JSONL_PROBE2(dump_to_file__done, out.size(), static_cast<int>(!fout));
 }
 
-static inline bool in_range(long x, long lower, long upper)
+/**
+ * Binary snapshot
+ *
+ * Layout, 64-bit words in the writer's byte order (the header records it
+ * and readers reject a mismatch), every record 8-byte aligned:
+ *   header : magic, version/byte order, total size, root offset
+ *   record : tag word (kind in the low byte, payload above it) + body
+ *     NUL/FALSE/TRUE  no body
+ *     INT             int stored in the payload
+ *     DOUBLE          one word of IEEE-754 bits
+ *     STRING          payload = length, bytes + '\0' padded to 8
+ *     ARRAY           payload = count, count element offsets
+ *     OBJECT          payload = count, count (key offset, value offset) pairs in key order
+ * Offsets are relative to the start of the snapshot, so it can be mapped
+ * anywhere. Children are written before their parent, so every offset
+ * points back to an earlier record.
+ */
+
+namespace
+{
+
+enum SnapshotKind : uint64_t
 {
-    return (x >= lower) && (x <= upper);
-}
+    SNAP_NUL = 0,
+    SNAP_FALSE = 1,
+    SNAP_TRUE = 2,
+    SNAP_INT = 3,
+    SNAP_DOUBLE = 4,
+    SNAP_STRING = 5,
+    SNAP_ARRAY = 6,
+    SNAP_OBJECT = 7
+};
 
-namespace
+struct SnapshotHeader
 {
+    char magic[8];
+    uint32_t version;
+    uint32_t byte_order;
+    uint64_t size;
+    uint64_t root;
+};
 
-struct JsonParser final
+static const char snapshot_magic[8] = {'j', 's', 'o', 'n', 'L', 's', 'n', 'p'};
+static const uint32_t snapshot_version = 1;
+static const uint32_t snapshot_byte_order = 0x01020304;
+static const uint64_t snapshot_null_record = SNAP_NUL;
+
+class SnapshotWriter final
 {
-    const string &str;
-    size_t i;
-    string &err;
-    bool failed;
-    const JsonParse strategy;
+public:
+    SnapshotWriter(string &out, string &err) : out(out), err(err) {}
 
-    // 设置错误信息，返回NULL
-    Json fail(string &&msg)
+    /**
+     * False, with out as it was, if a raw value in json does not parse
+     */
+    bool write_document(const Json &json)
     {
-        return fail(move(msg), Json());
-    }
+        size_t start = out.size();
+        SnapshotHeader header;
+        memcpy(header.magic, snapshot_magic, sizeof header.magic);
+        header.version = snapshot_version;
+        header.byte_order = snapshot_byte_order;
+        header.size = 0;
+        header.root = 0;
+        out.append(reinterpret_cast<const char *>(&header), sizeof header);
+        base = start;
 
-    template <typename T>
-    T fail(string &&msg, const T err_ret)
-    {
-        if (!failed)
-            err = std::move(msg);
-        failed = true;
-        return err_ret;
+        header.root = write(json);
+        if (failed)
+        {
+            out.resize(start);
+            return false;
+        }
+        header.size = out.size() - start;
+        memcpy(&out[start], &header, sizeof header);
+        return true;
     }
 
-    /*
-        * consume ws
-        * ws = *(%x20 / %x09 / %x0A / %x0D) 空格符space、制表符tab、换行符LF、回车符CR
-        */
-    void consume_whitespace()
+private:
+    string &out;
+    string &err;
+    bool failed = false;
+    size_t base = 0;
+    // shared records, 0 until written (the header sits at offset 0)
+    uint64_t null_off = 0;
+    uint64_t true_off = 0;
+    uint64_t false_off = 0;
+    std::unordered_map<string, uint64_t> strings;
+
+    uint64_t offset() const { return out.size() - base; }
+
+    void word(uint64_t w)
     {
-        while (str[i] == ' ' || str[i] == '\t' || str[i] == '\n' || str[i] == '\r')
-            ++i;
+        out.append(reinterpret_cast<const char *>(&w), sizeof w);
     }
 
-    /**
-     * Consume comment
-     */
-    bool consume_comment()
+    uint64_t tag(uint64_t kind, uint64_t payload)
     {
-        bool comment_found = false;
-        if (str[i] == '/')
-        {
-            i++;
-            if (i == str.size())
-                return fail("unexpected end of input after start of comment", false);
-            if (str[i] == '/')
-            { // inline comment
-                i++;
-                // advance until next line, or end of input
-                while (i < str.size() && str[i] != '\n')
-                {
-                    i++;
-                }
-                comment_found = true;
-            }
-            else if (str[i] == '*')
-            { // multiline comment
-                i++;
-                if (i > str.size() - 2)
-                    return fail("unexpected end of input inside multi-line comment", false);
-                // advance until closing tokens
-                while (!(str[i] == '*' && str[i + 1] == '/'))
-                {
-                    i++;
-                    if (i > str.size() - 2)
-                        return fail(
-                            "unexpected end of input inside multi-line comment", false);
-                }
-                i += 2;
-                comment_found = true;
-            }
-            else
-                return fail("malformed comment", false);
-        }
-        return comment_found;
+        uint64_t off = offset();
+        word(kind | (payload << 8));
+        return off;
     }
 
-    /**
-     * advance
-     */
-    void consume_garbage()
+    uint64_t shared(uint64_t &off, uint64_t kind)
     {
-        consume_whitespace();
-        if (strategy == JsonParse::COMMENTS)
-        {
-            bool comment_found = false;
-            do
-            {
-                comment_found = consume_comment();
-                if (failed)
-                    return;
-                consume_whitespace();
-            } while (comment_found);
-        }
+        if (off == 0)
+            off = tag(kind, 0);
+        return off;
     }
 
-    /**
-     * get next token
-     */
-    char get_next_token()
+    uint64_t write_string(const string &value)
     {
-        consume_garbage();
-        if (failed)
-            return static_cast<char>(0);
-        if (i == str.size())
-            return fail("unexpected end of input", static_cast<char>(0));
-        return str[i++];
+        auto iter = strings.find(value);
+        if (iter != strings.end())
+            return iter->second;
+
+        uint64_t off = tag(SNAP_STRING, value.size());
+        out.append(value);
+        // terminating '\0' plus padding up to the next word
+        out.append(8 - value.size() % 8, '\0');
+        strings.emplace(value, off);
+        return off;
     }
 
-    /**
-     * Parse a double.
-     */
-    Json parse_number()
+    uint64_t write_number(double value)
     {
-        size_t start_pos = i;
+        // ints round-trip through dump identically, keep them in one word
+        int int_value;
+        if (exact_int(value, int_value))
+            return tag(SNAP_INT, static_cast<uint32_t>(int_value));
 
-        if (str[i] == '-')
-            i++;
+        uint64_t off = tag(SNAP_DOUBLE, 0);
+        uint64_t bits;
+        memcpy(&bits, &value, sizeof bits);
+        word(bits);
+        return off;
+    }
 
-        if (str[i] == '0')
+    uint64_t write(const Json &json)
+    {
+        switch (json.type())
         {
-            i++;
-            if (in_range(str[i], '0', '9'))
-                return fail("leading 0s not permitted in numbers");
-        }
-        else if (in_range(str[i], '1', '9'))
+        case Json::Type::NUL:
+            return shared(null_off, SNAP_NUL);
+        case Json::Type::BOOL:
+            return json.bool_value() ? shared(true_off, SNAP_TRUE) : shared(false_off, SNAP_FALSE);
+        case Json::Type::NUMBER:
+            return write_number(json.number_value());
+        case Json::Type::STRING:
+            return write_string(json.string_value());
+        case Json::Type::ARRAY:
         {
-            i++;
-            while (in_range(str[i], '0', '9'))
-                i++;
+            const auto &items = json.array_items();
+            vector<uint64_t> offsets;
+            offsets.reserve(items.size());
+            for (const auto &item : items)
+                offsets.push_back(write(item));
+            uint64_t off = tag(SNAP_ARRAY, offsets.size());
+            for (uint64_t child : offsets)
+                word(child);
+            return off;
         }
-        else
+        case Json::Type::OBJECT:
         {
-            return fail("invalid " + esc(str[i]) + "in number");
+            const auto &items = json.object_items();
+            vector<uint64_t> offsets;
+            offsets.reserve(items.size() * 2);
+            for (const auto &item : items)
+            {
+                offsets.push_back(write_string(item.first));
+                offsets.push_back(write(item.second));
+            }
+            uint64_t off = tag(SNAP_OBJECT, items.size());
+            for (uint64_t child : offsets)
+                word(child);
+            return off;
         }
-
-        if (str[i] != '.' && str[i] != 'e' && str[i] != 'E' && (i - start_pos) <= static_cast<size_t>(std::numeric_limits<int>::digits10))
+        case Json::Type::RAW:
         {
-            return std::atoi(str.c_str() + start_pos);
+            // snapshots hold values, so the text is parsed here
+            if (failed)
+                return 0;
+            string parse_err;
+            Json value = Json::parse(json.dump(), parse_err);
+            if (!parse_err.empty())
+            {
+                err = "raw value: " + parse_err;
+                failed = true;
+                return 0;
+            }
+            return write(value);
         }
+        }
+        return shared(null_off, SNAP_NUL);
+    }
+};
 
-        if (str[i] == '.')
-        {
-            i++;
-            if (!in_range(str[i], '0', '9'))
-                return fail("at least one digit required in fractional part");
+inline uint64_t snapshot_kind(const uint64_t *rec)
+{
+    return rec[0] & 0xff;
+}
 
-            while (in_range(str[i], '0', '9'))
-                i++;
+/**
+ * Walk every record once, in file order: each must have a known kind,
+ * fit in the buffer, and point only at records that start before it, and
+ * object keys only at strings. Views can then follow any offset without
+ * a check and never loop.
+ */
+bool snapshot_records_valid(const uint64_t *words, size_t count, uint64_t root)
+{
+    vector<bool> starts(count);
+    size_t pos = sizeof(SnapshotHeader) / sizeof(uint64_t);
+    while (pos < count)
+    {
+        size_t rec = pos++;
+        uint64_t payload = words[rec] >> 8;
+        size_t left = count - pos;
+        size_t children = 0;
+        switch (words[rec] & 0xff)
+        {
+        case SNAP_NUL:
+        case SNAP_FALSE:
+        case SNAP_TRUE:
+        case SNAP_INT:
+            break;
+        case SNAP_DOUBLE:
+            if (left < 1)
+                return false;
+            pos += 1;
+            break;
+        case SNAP_STRING:
+            if (payload / 8 + 1 > left)
+                return false;
+            pos += payload / 8 + 1;
+            break;
+        case SNAP_ARRAY:
+            if (payload > left)
+                return false;
+            children = payload;
+            break;
+        case SNAP_OBJECT:
+            if (payload > left / 2)
+                return false;
+            children = payload * 2;
+            break;
+        default:
+            return false;
         }
 
-        if (str[i] == 'e' || str[i] == 'E')
+        for (size_t k = 0; k < children; k++)
         {
-            i++;
-            if (str[i] == '+' || str[i] == '-')
-                i++;
-            if (!in_range(str[i], '0', '9'))
-                return fail("at least one digit required in exponent");
-            while (in_range(str[i], '0', '9'))
-                i++;
+            uint64_t off = words[pos + k];
+            if (off % sizeof(uint64_t) != 0 || off / sizeof(uint64_t) >= rec || !starts[off / sizeof(uint64_t)])
+                return false;
+            bool is_key = (words[rec] & 0xff) == SNAP_OBJECT && k % 2 == 0;
+            if (is_key && (words[off / sizeof(uint64_t)] & 0xff) != SNAP_STRING)
+                return false;
         }
+        pos += children;
+        starts[rec] = true;
+    }
+    return starts[root / sizeof(uint64_t)];
+}
+
+inline uint64_t snapshot_payload(const uint64_t *rec)
+{
+    return rec[0] >> 8;
+}
+
+inline JsonStringRef snapshot_string(const uint64_t *rec)
+{
+    return JsonStringRef{reinterpret_cast<const char *>(rec + 1),
+                         static_cast<size_t>(snapshot_payload(rec))};
+}
+
+// same ordering as std::string::compare, i.e. std::map key order
+inline int snapshot_compare(JsonStringRef lhs, const string &rhs)
+{
+    size_t n = lhs.size < rhs.size() ? lhs.size : rhs.size();
+    int cmp = memcmp(lhs.data, rhs.data(), n);
+    if (cmp != 0)
+        return cmp;
+    if (lhs.size == rhs.size())
+        return 0;
+    return lhs.size < rhs.size() ? -1 : 1;
+}
 
-        return std::strtod(str.c_str() + start_pos, nullptr);
+} // namespace
+
+bool Json::dump_snapshot(string &out, string &err) const
+{
+    SnapshotWriter writer(out, err);
+    return writer.write_document(*this);
+}
+
+bool Json::dump_snapshot_to_file(const std::string &filename, std::string &err) const
+{
+    string out;
+    if (!dump_snapshot(out, err))
+        return false;
+    ofstream fout(filename, std::ios::binary);
+    if (!fout.is_open())
+    {
+        err = "can not open the file";
+        return false;
+    }
+    fout.write(out.data(), out.size());
+    if (!fout)
+    {
+        err = "can not write the file";
+        return false;
     }
+    return true;
+}
 
-    /**
-     * encode UTF-8
-     */
-    void encode_utf8(long pt, string &out)
+/**
+ * Snapshot views
+ */
+
+JsonSnapshotView JsonSnapshotView::at(uint64_t offset) const
+{
+    return JsonSnapshotView(m_base, reinterpret_cast<const uint64_t *>(m_base + offset));
+}
+
+Json::Type JsonSnapshotView::type() const
+{
+    switch (snapshot_kind(m_rec))
     {
-        if (pt < 0)
-            return;
+    case SNAP_FALSE:
+    case SNAP_TRUE:
+        return Json::Type::BOOL;
+    case SNAP_INT:
+    case SNAP_DOUBLE:
+        return Json::Type::NUMBER;
+    case SNAP_STRING:
+        return Json::Type::STRING;
+    case SNAP_ARRAY:
+        return Json::Type::ARRAY;
+    case SNAP_OBJECT:
+        return Json::Type::OBJECT;
+    default:
+        return Json::Type::NUL;
+    }
+}
 
-        if (pt < 0x80)
-        {
-            out += static_cast<char>(pt);
-        }
-        else if (pt < 0x800)
-        {
-            out += static_cast<char>((pt >> 6) | 0xC0);
-            out += static_cast<char>((pt & 0x3F) | 0x80);
-        }
-        else if (pt < 0x10000)
-        {
-            out += static_cast<char>((pt >> 12) | 0xE0);
-            out += static_cast<char>(((pt >> 6) & 0x3F) | 0x80);
-            out += static_cast<char>((pt & 0x3F) | 0x80);
-        }
+double JsonSnapshotView::number_value() const
+{
+    if (snapshot_kind(m_rec) == SNAP_INT)
+        return int_value();
+    if (snapshot_kind(m_rec) != SNAP_DOUBLE)
+        return 0;
+    double value;
+    memcpy(&value, m_rec + 1, sizeof value);
+    return value;
+}
+
+int JsonSnapshotView::int_value() const
+{
+    if (snapshot_kind(m_rec) == SNAP_INT)
+        return static_cast<int32_t>(static_cast<uint32_t>(snapshot_payload(m_rec)));
+    if (snapshot_kind(m_rec) == SNAP_DOUBLE)
+        return static_cast<int>(number_value());
+    return 0;
+}
+
+bool JsonSnapshotView::bool_value() const
+{
+    return snapshot_kind(m_rec) == SNAP_TRUE;
+}
+
+JsonStringRef JsonSnapshotView::string_value() const
+{
+    if (snapshot_kind(m_rec) != SNAP_STRING)
+        return JsonStringRef{"", 0};
+    return snapshot_string(m_rec);
+}
+
+size_t JsonSnapshotView::size() const
+{
+    uint64_t kind = snapshot_kind(m_rec);
+    return (kind == SNAP_ARRAY || kind == SNAP_OBJECT) ? snapshot_payload(m_rec) : 0;
+}
+
+JsonSnapshotView::ArrayRange JsonSnapshotView::array_items() const
+{
+    if (snapshot_kind(m_rec) != SNAP_ARRAY)
+        return ArrayRange(m_base, m_rec + 1, 0);
+    return ArrayRange(m_base, m_rec + 1, snapshot_payload(m_rec));
+}
+
+JsonSnapshotView::ObjectRange JsonSnapshotView::object_items() const
+{
+    if (snapshot_kind(m_rec) != SNAP_OBJECT)
+        return ObjectRange(m_base, m_rec + 1, 0);
+    return ObjectRange(m_base, m_rec + 1, snapshot_payload(m_rec));
+}
+
+JsonSnapshotView JsonSnapshotView::operator[](size_t i) const
+{
+    if (snapshot_kind(m_rec) != SNAP_ARRAY || i >= snapshot_payload(m_rec))
+        return JsonSnapshotView(nullptr, &snapshot_null_record);
+    return at(m_rec[1 + i]);
+}
+
+JsonSnapshotView JsonSnapshotView::operator[](const string &key) const
+{
+    if (snapshot_kind(m_rec) != SNAP_OBJECT)
+        return JsonSnapshotView(nullptr, &snapshot_null_record);
+
+    // members are stored in key order, binary search the pairs
+    const uint64_t *pairs = m_rec + 1;
+    size_t lo = 0, hi = snapshot_payload(m_rec);
+    while (lo < hi)
+    {
+        size_t mid = lo + (hi - lo) / 2;
+        const uint64_t *key_rec = reinterpret_cast<const uint64_t *>(m_base + pairs[2 * mid]);
+        int cmp = snapshot_compare(snapshot_string(key_rec), key);
+        if (cmp == 0)
+            return at(pairs[2 * mid + 1]);
+        if (cmp < 0)
+            lo = mid + 1;
         else
-        {
-            out += static_cast<char>((pt >> 18) | 0xF0);
-            out += static_cast<char>(((pt >> 12) & 0x3F) | 0x80);
-            out += static_cast<char>(((pt >> 6) & 0x3F) | 0x80);
-            out += static_cast<char>((pt & 0x3F) | 0x80);
-        }
+            hi = mid;
     }
+    return JsonSnapshotView(nullptr, &snapshot_null_record);
+}
 
-    /**
-     * Parse a string
-     */
-    string parse_string()
+Json JsonSnapshotView::to_json() const
+{
+    switch (snapshot_kind(m_rec))
     {
-        string out;
-        long last_escaped_codepoint = -1;
-        while (true)
-        {
-            if (i == str.size())
-                return fail("unexpected end of input in string", "");
-
-            char ch = str[i++];
-
-            if (ch == '"')
-            {
-                encode_utf8(last_escaped_codepoint, out);
-                return out;
-            }
+    case SNAP_FALSE:
+        return false;
+    case SNAP_TRUE:
+        return true;
+    case SNAP_INT:
+        return int_value();
+    case SNAP_DOUBLE:
+        return number_value();
+    case SNAP_STRING:
+        return string_value().str();
+    case SNAP_ARRAY:
+    {
+        Json::array values;
+        values.reserve(size());
+        for (const auto &item : array_items())
+            values.push_back(item.to_json());
+        return values;
+    }
+    case SNAP_OBJECT:
+    {
+        Json::object values;
+        for (const auto &item : object_items())
+            values.emplace_hint(values.end(), item.first.str(), item.second.to_json());
+        return values;
+    }
+    default:
+        return Json();
+    }
+}
 
-            if (in_range(ch, 0, 0x1f))
-                return fail("unescaped " + esc(ch) + " in string", "");
+void JsonSnapshotView::dump(string &out, const JsonFormat &format) const
+{
+    dump_formatted(*this, out, format);
+}
 
-            if (ch != '\\')
-            {
-                encode_utf8(last_escaped_codepoint, out);
-                last_escaped_codepoint = -1;
-                out += ch;
-                continue;
-            }
+JsonSnapshotView JsonSnapshotView::ArrayRange::iterator::operator*() const
+{
+    return JsonSnapshotView(m_base, reinterpret_cast<const uint64_t *>(m_base + *m_pos));
+}
 
-            if (i == str.size())
-                return fail("unexpected end of input in string", "");
+JsonSnapshotView::ObjectRange::value_type JsonSnapshotView::ObjectRange::iterator::operator*() const
+{
+    const uint64_t *key_rec = reinterpret_cast<const uint64_t *>(m_base + m_pos[0]);
+    return value_type(snapshot_string(key_rec),
+                      JsonSnapshotView(m_base, reinterpret_cast<const uint64_t *>(m_base + m_pos[1])));
+}
 
-            ch = str[i++];
+/**
+ * Snapshot storage
+ */
 
-            if (ch == 'u')
-            {
-                string esc = str.substr(i, 4);
+JsonSnapshot::JsonSnapshot() noexcept
+    : m_data(nullptr), m_size(0), m_map(nullptr), m_map_size(0), m_owned(nullptr) {}
 
-                if (esc.length() < 4)
-                {
-                    return fail("bad \\u escape: " + esc, "");
-                }
-                for (size_t j = 0; j < 4; j++)
-                {
-                    if (!in_range(esc[j], 'a', 'f') && !in_range(esc[j], 'A', 'F') && !in_range(esc[j], '0', '9'))
-                        return fail("bad \\u escape: " + esc, "");
-                }
+JsonSnapshot::~JsonSnapshot()
+{
+    reset();
+}
 
-                long codepoint = strtol(esc.data(), nullptr, 16);
+JsonSnapshot::JsonSnapshot(JsonSnapshot &&other) noexcept
+    : m_data(other.m_data), m_size(other.m_size), m_map(other.m_map),
+      m_map_size(other.m_map_size), m_owned(other.m_owned)
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+    other.m_map = nullptr;
+    other.m_map_size = 0;
+    other.m_owned = nullptr;
+}
 
-                if (in_range(last_escaped_codepoint, 0xD800, 0xDBFF) && in_range(codepoint, 0xDC00, 0xDFFF))
-                {
-                    encode_utf8((((last_escaped_codepoint - 0xD800) << 10) | (codepoint - 0xDC00)) + 0x10000, out);
-                    last_escaped_codepoint = -1;
-                }
-                else
-                {
-                    encode_utf8(last_escaped_codepoint, out);
-                    last_escaped_codepoint = codepoint;
-                }
+JsonSnapshot &JsonSnapshot::operator=(JsonSnapshot &&other) noexcept
+{
+    if (this != &other)
+    {
+        reset();
+        std::swap(m_data, other.m_data);
+        std::swap(m_size, other.m_size);
+        std::swap(m_map, other.m_map);
+        std::swap(m_map_size, other.m_map_size);
+        std::swap(m_owned, other.m_owned);
+    }
+    return *this;
+}
 
-                i += 4;
-                continue;
-            }
+void JsonSnapshot::reset() noexcept
+{
+#ifdef JSONL_HAS_MMAP
+    if (m_map)
+        munmap(m_map, m_map_size);
+#endif
+    delete[] m_owned;
+    m_data = nullptr;
+    m_size = 0;
+    m_map = nullptr;
+    m_map_size = 0;
+    m_owned = nullptr;
+}
 
-            encode_utf8(last_escaped_codepoint, out);
-            last_escaped_codepoint = -1;
+JsonSnapshot JsonSnapshot::from_buffer(const char *data, size_t size, string &err)
+{
+    JsonSnapshot snapshot;
+    if (!data || reinterpret_cast<uintptr_t>(data) % sizeof(uint64_t) != 0)
+    {
+        err = "snapshot buffer must be 8-byte aligned";
+        return snapshot;
+    }
+    if (size < sizeof(SnapshotHeader))
+    {
+        err = "snapshot too small";
+        return snapshot;
+    }
 
-            if (ch == 'b')
-            {
-                out += '\b';
-            }
-            else if (ch == 'f')
-            {
-                out += '\f';
-            }
-            else if (ch == 'n')
-            {
-                out += '\n';
-            }
-            else if (ch == 'r')
-            {
-                out += '\r';
-            }
-            else if (ch == 't')
-            {
-                out += '\t';
-            }
-            else if (ch == '"' || ch == '\\' || ch == '/')
-            {
-                out += ch;
-            }
-            else
-            {
-                return fail("invalid escape character " + esc(ch), "");
-            }
-        }
+    SnapshotHeader header;
+    memcpy(&header, data, sizeof header);
+    if (memcmp(header.magic, snapshot_magic, sizeof header.magic) != 0)
+    {
+        err = "not a jsonL snapshot";
+        return snapshot;
+    }
+    if (header.byte_order != snapshot_byte_order)
+    {
+        err = "snapshot byte order mismatch";
+        return snapshot;
+    }
+    if (header.version != snapshot_version)
+    {
+        err = "unsupported snapshot version";
+        return snapshot;
+    }
+    if (header.size != size || header.root < sizeof header || header.root >= size || header.root % sizeof(uint64_t) != 0)
+    {
+        err = "corrupt snapshot header";
+        return snapshot;
+    }
+    if (size % sizeof(uint64_t) != 0 ||
+        !snapshot_records_valid(reinterpret_cast<const uint64_t *>(data), size / sizeof(uint64_t), header.root))
+    {
+        err = "corrupt snapshot records";
+        return snapshot;
     }
 
-    /**
-     * expect null true false
-     */
-    Json expect(const string &expected, Json res)
+    snapshot.m_data = data;
+    snapshot.m_size = size;
+    return snapshot;
+}
+
+JsonSnapshot JsonSnapshot::open(const string &filename, string &err)
+{
+#ifdef JSONL_HAS_MMAP
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0)
     {
-        assert(i != 0);
-        size_t len = expected.length();
-        i--;
-        if (str.compare(i, len, expected) == 0)
-        {
-            i += len;
-            return res;
-        }
-        else
-        {
-            return fail("parse error : expected " + expected + ", got " + str.substr(i, len));
-        }
+        err = "can not open the file";
+        return JsonSnapshot();
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size <= 0)
+    {
+        ::close(fd);
+        err = "snapshot too small";
+        return JsonSnapshot();
+    }
+    size_t size = static_cast<size_t>(st.st_size);
+    void *map = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (map == MAP_FAILED)
+    {
+        err = "can not map the file";
+        return JsonSnapshot();
     }
 
-    /**
-     * Parse a JSON object
-     */
-    Json parse_json(int depth)
+    JsonSnapshot snapshot = from_buffer(static_cast<const char *>(map), size, err);
+    if (!snapshot.valid())
     {
-        if (depth > max_depth)
-        {
-            return fail("exceeded maximum nesting depth");
-        }
+        munmap(map, size);
+        return snapshot;
+    }
+    snapshot.m_map = map;
+    snapshot.m_map_size = size;
+    return snapshot;
+#else
+    ifstream fin(filename, std::ios::binary);
+    if (!fin.is_open())
+    {
+        err = "can not open the file";
+        return JsonSnapshot();
+    }
+    fin.seekg(0, std::ios::end);
+    size_t size = static_cast<size_t>(fin.tellg());
+    fin.seekg(0, std::ios::beg);
+    uint64_t *owned = new uint64_t[size / sizeof(uint64_t) + 1];
+    fin.read(reinterpret_cast<char *>(owned), size);
 
-        char ch = get_next_token();
-        if (failed)
-            return Json();
+    JsonSnapshot snapshot = from_buffer(reinterpret_cast<const char *>(owned), size, err);
+    if (!snapshot.valid())
+    {
+        delete[] owned;
+        return snapshot;
+    }
+    snapshot.m_owned = owned;
+    return snapshot;
+#endif
+}
 
-        if (ch == '-' || (ch >= '0' && ch <= '9'))
-        {
-            i--;
-            return parse_number();
-        }
+JsonSnapshotView JsonSnapshot::root() const
+{
+    if (!m_data)
+        return JsonSnapshotView(nullptr, &snapshot_null_record);
+    SnapshotHeader header;
+    memcpy(&header, m_data, sizeof header);
+    return JsonSnapshotView(m_data, reinterpret_cast<const uint64_t *>(m_data + header.root));
+}
 
-        if (ch == 'n')
-            return expect("null", Json());
+/**
+ * Tape
+ */
 
-        if (ch == 't')
-            return expect("true", true);
+template <class Syntax>
+static bool parse_tape_checked(const string &in, string &err, size_t depth_limit, vector<uint64_t> &tape, string &strings)
+{
+    JsonParser<Syntax> parser{in, 0, err, false, nullptr, depth_limit, false, false};
+    parser.parse_tape(tape, strings);
 
-        if (ch == 'f')
-            return expect("false", false);
+    parser.consume_garbage();
+    if (!parser.failed && parser.i != in.size())
+        parser.fail("unexpected trailing " + esc(in[parser.i]));
+    return !parser.failed;
+}
 
-        if (ch == '"')
-            return parse_string();
+template <class Syntax>
+static bool parse_tape_document(const string &in, string &err, const JsonParseOptions &options,
+                                vector<uint64_t> &tape, string &strings)
+{
+    if (options.validate_utf8)
+        return parse_tape_checked<Utf8Syntax<Syntax>>(in, err, options.max_depth, tape, strings);
+    return parse_tape_checked<Syntax>(in, err, options.max_depth, tape, strings);
+}
 
-        if (ch == '{')
-        {
-            map<string, Json> data;
-            ch = get_next_token();
-            if (ch == '}')
-                return data;
+JsonTape JsonTape::parse(const std::string &in,
+                         std::string &err,
+                         const JsonParseOptions &options)
+{
+    JsonTape doc;
+    doc.m_tape.reserve(in.size() / 8 + 2);
+    doc.m_strings.reserve(in.size() / 2);
+    bool ok = false;
+    switch (options.strategy)
+    {
+    case JsonParse::STANDARD:
+        ok = parse_tape_document<StandardSyntax>(in, err, options, doc.m_tape, doc.m_strings);
+        break;
+    case JsonParse::COMMENTS:
+        ok = parse_tape_document<CommentSyntax>(in, err, options, doc.m_tape, doc.m_strings);
+        break;
+    case JsonParse::RELAXED:
+        ok = parse_tape_document<RelaxedSyntax>(in, err, options, doc.m_tape, doc.m_strings);
+        break;
+    }
+    if (!ok)
+    {
+        doc.m_tape.clear();
+        doc.m_strings.clear();
+    }
+    return doc;
+}
 
-            while (1)
-            {
-                if (ch != '"')
-                    return fail("expected '\"' in object, got " + esc(ch));
+static const uint64_t tape_null_word = tape_word(TAPE_NUL, 0);
 
-                string key = parse_string();
-                if (failed)
-                    return Json();
+JsonTapeView JsonTape::root() const
+{
+    if (m_tape.empty())
+        return JsonTapeView(&tape_null_word, nullptr, 0);
+    return JsonTapeView(m_tape.data(), m_strings.data(), 0);
+}
 
-                ch = get_next_token();
-                if (ch != ':')
-                    return fail("expected ':' in object, got " + esc(ch));
+// index just past the value starting at index
+static inline size_t tape_skip(const uint64_t *tape, size_t index)
+{
+    uint64_t word = tape[index];
+    switch (tape_kind(word))
+    {
+    case TAPE_ARRAY:
+    case TAPE_OBJECT:
+        return static_cast<uint32_t>(tape_payload(word));
+    case TAPE_DOUBLE:
+        return index + 2;
+    default:
+        return index + 1;
+    }
+}
 
-                data[std::move(key)] = parse_json(depth + 1);
-                if (failed)
-                    return Json();
+static inline JsonStringRef tape_string(const char *strings, uint64_t word)
+{
+    const char *p = strings + tape_payload(word);
+    uint32_t length;
+    memcpy(&length, p, sizeof length);
+    return JsonStringRef{p + sizeof length, length};
+}
 
-                ch = get_next_token();
-                if (ch == '}')
-                    break;
-                if (ch != ',')
-                    return fail("expected ',' in object, got " + esc(ch));
+Json::Type JsonTapeView::type() const
+{
+    switch (tape_kind(m_tape[m_index]))
+    {
+    case TAPE_TRUE:
+    case TAPE_FALSE:
+        return Json::Type::BOOL;
+    case TAPE_INT:
+    case TAPE_DOUBLE:
+        return Json::Type::NUMBER;
+    case TAPE_STRING:
+        return Json::Type::STRING;
+    case TAPE_ARRAY:
+        return Json::Type::ARRAY;
+    case TAPE_OBJECT:
+        return Json::Type::OBJECT;
+    default:
+        return Json::Type::NUL;
+    }
+}
 
-                ch = get_next_token();
-            }
-            return data;
-        }
+double JsonTapeView::number_value() const
+{
+    uint64_t kind = tape_kind(m_tape[m_index]);
+    if (kind == TAPE_INT)
+        return int_value();
+    if (kind != TAPE_DOUBLE)
+        return 0;
+    double value;
+    memcpy(&value, &m_tape[m_index + 1], sizeof value);
+    return value;
+}
 
-        if (ch == '[')
-        {
-            vector<Json> data;
-            ch = get_next_token();
-            if (ch == ']')
-                return data;
+int JsonTapeView::int_value() const
+{
+    uint64_t kind = tape_kind(m_tape[m_index]);
+    if (kind == TAPE_INT)
+        return static_cast<int32_t>(static_cast<uint32_t>(tape_payload(m_tape[m_index])));
+    if (kind == TAPE_DOUBLE)
+        return static_cast<int>(number_value());
+    return 0;
+}
 
-            while (1)
-            {
-                i--;
-                data.push_back(parse_json(depth + 1));
-                if (failed)
-                    return Json();
+bool JsonTapeView::bool_value() const
+{
+    return tape_kind(m_tape[m_index]) == TAPE_TRUE;
+}
 
-                ch = get_next_token();
-                if (ch == ']')
-                    break;
-                if (ch != ',')
-                    return fail("expected ',' in list, got " + esc(ch));
+JsonStringRef JsonTapeView::string_value() const
+{
+    if (tape_kind(m_tape[m_index]) != TAPE_STRING)
+        return JsonStringRef{"", 0};
+    return tape_string(m_strings, m_tape[m_index]);
+}
 
-                ch = get_next_token();
-                (void)ch;
-            }
-            return data;
-        }
+size_t JsonTapeView::size() const
+{
+    uint64_t word = m_tape[m_index];
+    uint64_t kind = tape_kind(word);
+    if (kind != TAPE_ARRAY && kind != TAPE_OBJECT)
+        return 0;
+    size_t count = static_cast<size_t>(tape_payload(word) >> 32);
+    if (count < tape_count_max)
+        return count;
 
-        return fail("expected value, got " + esc(ch));
+    // saturated count, walk the container
+    count = 0;
+    size_t last = static_cast<uint32_t>(tape_payload(word)) - 1;
+    for (size_t index = m_index + 1; index < last; index = tape_skip(m_tape, index))
+    {
+        if (kind == TAPE_OBJECT)
+            index++;
+        count++;
     }
-};
-
-} // namespace
+    return count;
+}
 
-Json Json::parse(const std::string &in,
-                    std::string &err,
-                    JsonParse strategy)
+JsonTapeView::ArrayRange JsonTapeView::array_items() const
 {
-    JsonParser parser{in, 0, err, false, strategy};
-    Json result = parser.parse_json(0);
+    uint64_t word = m_tape[m_index];
+    if (tape_kind(word) != TAPE_ARRAY)
+        return ArrayRange(m_tape, m_strings, m_index, m_index, 0);
+    size_t last = static_cast<uint32_t>(tape_payload(word)) - 1;
+    return ArrayRange(m_tape, m_strings, m_index + 1, last, size());
+}
 
-    parser.consume_garbage();
-    if (parser.failed)
-        return Json();
-    if (parser.i != in.size())
-        return parser.fail("unexpected trailing " + esc(in[parser.i]));
+JsonTapeView::ObjectRange JsonTapeView::object_items() const
+{
+    uint64_t word = m_tape[m_index];
+    if (tape_kind(word) != TAPE_OBJECT)
+        return ObjectRange(m_tape, m_strings, m_index, m_index, 0);
+    size_t last = static_cast<uint32_t>(tape_payload(word)) - 1;
+    return ObjectRange(m_tape, m_strings, m_index + 1, last, size());
+}
 
-    return result;
+JsonTapeView JsonTapeView::operator[](size_t i) const
+{
+    for (const auto &item : array_items())
+    {
+        if (i-- == 0)
+            return item;
+    }
+    return JsonTapeView(&tape_null_word, nullptr, 0);
 }
 
-std::vector<Json> Json::parse_multi(const std::string &in,
-                                    std::string::size_type &parser_stop_pos,
-                                    std::string &err,
-                                    JsonParse strategy)
+JsonTapeView JsonTapeView::operator[](const string &key) const
 {
-    JsonParser parser{in, 0, err, false, strategy};
-    parser_stop_pos = 0;
-    vector<Json> json_vec;
-    while (parser.i != in.size() && !parser.failed)
+    // members keep document order, the last duplicate wins as in Json::parse
+    JsonTapeView found(&tape_null_word, nullptr, 0);
+    for (const auto &item : object_items())
     {
-        json_vec.push_back(parser.parse_json(0));
-        if (parser.failed)
-            break;
-        parser.consume_garbage();
-        if (parser.failed)
-            break;
-        parser_stop_pos = parser.i;
+        if (item.first == key)
+            found = item.second;
     }
-    return json_vec;
+    return found;
 }
 
-bool Json::has_shape(const shape &types, std::string &err) const
+Json JsonTapeView::to_json() const
 {
-    if (!is_object())
+    switch (tape_kind(m_tape[m_index]))
     {
-        err = "expected JSON object, got " + dump();
+    case TAPE_TRUE:
+        return true;
+    case TAPE_FALSE:
         return false;
+    case TAPE_INT:
+        return int_value();
+    case TAPE_DOUBLE:
+        return number_value();
+    case TAPE_STRING:
+        return string_value().str();
+    case TAPE_ARRAY:
+    {
+        Json::array values;
+        values.reserve(size());
+        for (const auto &item : array_items())
+            values.push_back(item.to_json());
+        return values;
     }
-
-    const auto &obj_items = object_items();
-    for (auto &item : types)
+    case TAPE_OBJECT:
     {
-        const auto it = obj_items.find(item.first);
-        if (it == obj_items.cend() || it->second.type() != item.second)
-        {
-            err = "bad type for " + item.first + "in" + dump();
-            return false;
-        }
+        Json::object values;
+        for (const auto &item : object_items())
+            values[item.first.str()] = item.second.to_json();
+        return values;
+    }
+    default:
+        return Json();
     }
+}
 
-    return true;
+void JsonTapeView::dump(string &out, const JsonFormat &format) const
+{
+    dump_formatted(*this, out, format);
 }
 
-Json Json::parse_from_file(const std::string &filename,
-                            string &err,
-                            JsonParse strategy)
+JsonTapeView::ArrayRange::iterator &JsonTapeView::ArrayRange::iterator::operator++()
 {
-    ifstream fin(filename);
-    if (!fin.is_open())
-    {
-        err = "can not open the file";
-        return Json();
-    }
-    std::stringstream buffer;
-    buffer << fin.rdbuf();
-    string in = buffer.str();
-    fin.close();
-    return parse(in, err, strategy);
+    m_index = tape_skip(m_tape, m_index);
+    return *this;
 }
 
-void Json::dump_to_file(const std::string &filename) const
+JsonTapeView::ObjectRange::value_type JsonTapeView::ObjectRange::iterator::operator*() const
 {
-    ofstream fout(filename);
-    if (!fout.is_open())
-    {
-        std::cout << "can not open the file" << std::endl;
-        return;
-    }
-    fout << this->dump();
-    fout.close();
+    return value_type(tape_string(m_strings, m_tape[m_index]),
+                      JsonTapeView(m_tape, m_strings, m_index + 1));
+}
+
+JsonTapeView::ObjectRange::iterator &JsonTapeView::ObjectRange::iterator::operator++()
+{
+    m_index = tape_skip(m_tape, m_index + 1);
+    return *this;
 }
 
-} // namespace jsonL
\ No newline at end of file
+} // namespace jsonL
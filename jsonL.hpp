@@ -5,6 +5,8 @@
 #include <map>
 #include <memory>
 #include <initializer_list>
+#include <cstdint>
+#include <cstring>
 namespace jsonL
 {
     
@@ -14,10 +16,230 @@ namespace jsonL
 enum class JsonParse
 {
     STANDARD,
-    COMMENTS
+    COMMENTS,
+    RELAXED // comments, trailing commas, 'single quotes' and unquoted keys
+};
+
+/**
+ * Scanning/escaping kernels, picked at load time from cpuid. JSONL_KERNEL
+ * (environment or CMake cache) or Json::set_kernel forces one.
+ */
+enum class JsonKernel
+{
+    SCALAR,
+    SSE42,
+    AVX2,
+    AVX512
+};
+
+/**
+ * Serialize format
+ */
+struct JsonFormat
+{
+    enum class Style
+    {
+        STANDARD, // ", " and ": " separators on one line
+        MINIFIED, // no insignificant whitespace
+        PRETTY    // one element per line, indented
+    };
+
+    Style style = Style::STANDARD;
+    unsigned indent = 4;
+    char indent_char = ' ';
+    // sorted or document order; Json objects are std::map and always sorted
+    bool sort_keys = true;
+    // \uXXXX for every non-ASCII code point instead of raw UTF-8
+    bool ascii_only = false;
+
+    static JsonFormat minified()
+    {
+        JsonFormat format;
+        format.style = Style::MINIFIED;
+        return format;
+    }
+
+    static JsonFormat pretty(unsigned indent = 4, char indent_char = ' ')
+    {
+        JsonFormat format;
+        format.style = Style::PRETTY;
+        format.indent = indent;
+        format.indent_char = indent_char;
+        return format;
+    }
+};
+
+/**
+ * Per-parse statistics, filled by Json::parse when the library is built
+ * with JSONL_PARSE_STATS; otherwise enabled stays false and the counters 0.
+ */
+struct JsonParseStats
+{
+    bool enabled = false;
+
+    // values by type, object keys counted separately
+    size_t nulls = 0;
+    size_t bools = 0;
+    size_t numbers = 0;
+    size_t strings = 0;
+    size_t arrays = 0;
+    size_t objects = 0;
+    size_t keys = 0;
+
+    // input bytes consumed by each scanner
+    size_t string_bytes = 0;
+    size_t number_bytes = 0;
+    size_t whitespace_bytes = 0;
+    size_t comment_bytes = 0;
+
+    size_t escapes = 0;          // backslash escapes decoded
+    size_t strtod_fallbacks = 0; // numbers that missed the int fast path
+    size_t max_depth = 0;        // deepest nesting reached
+    size_t skipped_bytes = 0;    // values a projection left out
+
+    // DOM nodes allocated and their estimated heap footprint
+    size_t nodes = 0;
+    size_t node_bytes = 0;
+
+    uint64_t parse_ns = 0;
+};
+
+/**
+ * Paths for Json::parse to keep, see JsonParseOptions::projection. A path
+ * is object keys joined by '.', "*" standing for every array element or
+ * object member: "statuses.*.user.id". The containers leading to a path
+ * are kept, possibly empty; anything else is skipped without being built.
+ */
+class JsonProjection final
+{
+public:
+    static const size_t npos = static_cast<size_t>(-1);
+
+    JsonProjection() : m_nodes(1) {}
+    JsonProjection(std::initializer_list<std::string> paths) : m_nodes(1)
+    {
+        for (const std::string &path : paths)
+            add(path);
+    }
+
+    void add(const std::string &path);
+
+    /**
+     * Trie walk from node 0, the document root. npos means nothing below
+     * is kept; a node that keeps() is kept whole.
+     */
+    size_t child(size_t node, const std::string &key) const;
+    size_t element(size_t node) const;
+    bool keeps(size_t node) const { return m_nodes[node].whole; }
+
+private:
+    struct Node
+    {
+        std::map<std::string, size_t> children;
+        size_t any = npos; // the "*" child
+        bool whole = false;
+    };
+    std::vector<Node> m_nodes;
+
+    void insert(size_t node, const std::vector<std::string> &steps, size_t step);
+    size_t clone(size_t node);
+};
+
+/**
+ * Parse options beyond the strategy. Json::parse builds values without
+ * recursion, but dump, comparison and destruction of the result still
+ * recurse once per level, so keep max_depth finite for untrusted input.
+ */
+struct JsonParseOptions
+{
+    JsonParse strategy = JsonParse::STANDARD;
+    size_t max_depth = 200;           // deepest container nesting accepted
+    JsonParseStats *stats = nullptr; // see JsonParseStats
+    bool validate_utf8 = false;       // reject invalid UTF-8 and unpaired \u surrogates
+    // only build these paths; skipped values are checked as by validate,
+    // not built
+    const JsonProjection *projection = nullptr;
+    // keep number text as parsed: converted on first read, dumped verbatim
+    bool lazy_numbers = false;
+    // store arrays of only numbers as packed doubles, see Json::packed;
+    // ignored with lazy_numbers
+    bool pack_numbers = false;
+};
+
+/**
+ * What Json::validate saw: nesting depth and values by type, object keys
+ * counted separately. Unlike JsonParseStats it is always filled.
+ */
+struct JsonValidateStats
+{
+    size_t max_depth = 0;
+    size_t nulls = 0;
+    size_t bools = 0;
+    size_t numbers = 0;
+    size_t strings = 0;
+    size_t arrays = 0;
+    size_t objects = 0;
+    size_t keys = 0;
+};
+
+/**
+ * Which Json::cached nodes keep their text: dumps shorter than min_bytes
+ * are cheap to redo, and once max_bytes are held in total nothing new is
+ * kept until cached nodes are destroyed.
+ */
+struct JsonDumpCacheLimits
+{
+    size_t min_bytes = 256;
+    size_t max_bytes = size_t(64) << 20;
+};
+
+/**
+ * Text currently held by Json::cached nodes
+ */
+struct JsonDumpCacheStats
+{
+    size_t nodes = 0;
+    size_t bytes = 0;
 };
 
 class JsonValue;
+template <class Layout>
+class JsonWriter;
+struct JsonBuilder;
+
+/**
+ * Non-owning reference to string bytes
+ */
+struct JsonStringRef
+{
+    const char *data;
+    size_t size;
+
+    std::string str() const { return std::string(data, size); }
+    bool operator==(const std::string &rhs) const
+    {
+        return size == rhs.size() && std::memcmp(data, rhs.data(), size) == 0;
+    }
+    bool operator!=(const std::string &rhs) const { return !(*this == rhs); }
+    bool operator==(const JsonStringRef &rhs) const
+    {
+        return size == rhs.size && std::memcmp(data, rhs.data, size) == 0;
+    }
+};
+
+/**
+ * Non-owning run of packed numbers, see Json::packed_numbers
+ */
+struct JsonNumberSpan
+{
+    const double *data = nullptr;
+    size_t size = 0;
+
+    const double *begin() const { return data; }
+    const double *end() const { return data + size; }
+    double operator[](size_t i) const { return data[i]; }
+    bool empty() const { return size == 0; }
+};
 
 class Json final
 {
@@ -35,7 +257,8 @@ public:
         BOOL,
         STRING,
         ARRAY,
-        OBJECT
+        OBJECT,
+        RAW // pre-serialized text, see Json::raw
     };
 
     /**
@@ -73,6 +296,22 @@ public:
     //only accept const char * since std::string(const char *)
     Json(void *) = delete;
 
+    /**
+     * Pre-serialized JSON, dumped verbatim in every format (but for
+     * ascii_only, which escapes its non-ASCII bytes) and compared by its
+     * text. The err overload validates it once as standard JSON and
+     * returns null if that fails.
+     */
+    static Json raw(std::string text);
+    static Json raw(std::string text, std::string &err);
+
+    /**
+     * Array of numbers stored as one block of doubles. array_items() and
+     * operator[] build the element nodes on first use; packed_numbers()
+     * reads the block directly and is empty for any other value.
+     */
+    static Json packed(std::vector<double> values);
+
     /**
      * Accessors
      */
@@ -84,6 +323,7 @@ public:
     bool is_string() const { return type() == Type::STRING; }
     bool is_array() const { return type() == Type::ARRAY; }
     bool is_object() const { return type() == Type::OBJECT; }
+    bool is_raw() const { return type() == Type::RAW; }
 
     double number_value() const;
     int int_value() const;
@@ -95,6 +335,9 @@ public:
     const Json &operator[](size_t i) const;
     const Json &operator[](const std::string &key) const;
 
+    bool is_packed() const { return packed_numbers().data != nullptr; }
+    JsonNumberSpan packed_numbers() const;
+
     /**
      * Operator overload
      */
@@ -110,13 +353,24 @@ public:
      */
     static Json parse(const std::string &in,
                         std::string &err,
-                        JsonParse strategy = JsonParse::STANDARD);
+                        const JsonParseOptions &options);
+    static Json parse(const std::string &in,
+                        std::string &err,
+                        JsonParse strategy = JsonParse::STANDARD,
+                        JsonParseStats *stats = nullptr)
+    {
+        JsonParseOptions options;
+        options.strategy = strategy;
+        options.stats = stats;
+        return parse(in, err, options);
+    }
     static Json parse(const char *in,
                         std::string &err,
-                        JsonParse strategy = JsonParse::STANDARD)
+                        JsonParse strategy = JsonParse::STANDARD,
+                        JsonParseStats *stats = nullptr)
     {
         if (in)
-            return parse(std::string(in), err, strategy);
+            return parse(std::string(in), err, strategy, stats);
         else
         {
             err = "null input";
@@ -124,10 +378,23 @@ public:
         }
     }
 
+    /**
+     * Consecutive documents. Takes every option but stats, the projection
+     * applying to each document.
+     */
     static std::vector<Json> parse_multi(const std::string &in,
                                             std::string::size_type &parser_stop_pos,
                                             std::string &err,
-                                            JsonParse strategy = JsonParse::STANDARD);
+                                            const JsonParseOptions &options);
+    static inline std::vector<Json> parse_multi(const std::string &in,
+                                                std::string::size_type &parser_stop_pos,
+                                                std::string &err,
+                                                JsonParse strategy = JsonParse::STANDARD)
+    {
+        JsonParseOptions options;
+        options.strategy = strategy;
+        return parse_multi(in, parser_stop_pos, err, options);
+    }
 
     static inline std::vector<Json> parse_multi(const std::string &in,
                                                 std::string &err,
@@ -141,6 +408,34 @@ public:
                                 std::string &err,
                                 JsonParse strategy = JsonParse::STANDARD);
 
+    /**
+     * Check that in is one well-formed document without building it. Takes
+     * the strategy, max_depth and validate_utf8 from options; nesting is
+     * capped at 4096 levels. Allocates nothing unless it fails.
+     */
+    static bool validate(const char *in, size_t size, std::string &err,
+                         const JsonParseOptions &options = JsonParseOptions());
+    static bool validate(const char *in, size_t size, std::string &err, JsonValidateStats &stats,
+                         const JsonParseOptions &options = JsonParseOptions());
+
+    /**
+     * Minify or re-indent in straight from its tokens, appending to out.
+     * Number text and member order are kept, sort_keys is ignored, and
+     * relaxed input comes out as standard JSON. Checks like validate; on
+     * failure out is left as it was.
+     */
+    static bool reformat(const char *in, size_t size, std::string &out, std::string &err,
+                         const JsonFormat &format = JsonFormat::minified(),
+                         const JsonParseOptions &options = JsonParseOptions());
+
+    /**
+     * Kernel dispatch, set_kernel fails if the CPU lacks the instructions
+     */
+    static JsonKernel kernel();
+    static bool set_kernel(JsonKernel kernel);
+    static bool set_kernel(const std::string &name);
+    static const char *kernel_name(JsonKernel kernel);
+
     /**
      * Serialize
      */
@@ -151,9 +446,34 @@ public:
         dump(out);
         return out;
     }
+    void dump(std::string &out, const JsonFormat &format) const;
+    std::string dump(const JsonFormat &format) const
+    {
+        std::string out;
+        dump(out, format);
+        return out;
+    }
 
     void dump_to_file(const std::string &filename) const;
 
+    /**
+     * Shallow copy of an array or object that keeps the text of its first
+     * default-format dump, within the limits below, and appends it on every
+     * later one, nested in other values too. Other types come back as is.
+     */
+    Json cached() const;
+    static void set_dump_cache_limits(const JsonDumpCacheLimits &limits);
+    static JsonDumpCacheLimits dump_cache_limits();
+    static JsonDumpCacheStats dump_cache_stats();
+
+    /**
+     * Binary snapshot appended to out, read back through JsonSnapshot. Raw
+     * values are parsed into it; one that does not parse fails the dump and
+     * leaves out unchanged.
+     */
+    bool dump_snapshot(std::string &out, std::string &err) const;
+    bool dump_snapshot_to_file(const std::string &filename, std::string &err) const;
+
     /**
      * Type judgement
      */
@@ -161,6 +481,10 @@ public:
     bool has_shape(const shape &types, std::string &err) const;
 
 private:
+    template <class Layout>
+    friend class JsonWriter;
+    friend struct JsonBuilder;
+
     std::shared_ptr<JsonValue> m_ptr;
 };
 
@@ -170,6 +494,11 @@ protected:
     friend class Json;
     friend class JsonInt;
     friend class JsonDouble;
+    friend class JsonRawNumber;
+    friend class JsonArray;
+    friend class JsonPackedArray;
+    template <class Layout>
+    friend class JsonWriter;
 
     virtual Json::Type type() const = 0;
     virtual bool equals(const JsonValue *other) const = 0;
@@ -184,9 +513,358 @@ protected:
     virtual const Json &operator[](size_t i) const;
     virtual const Json::object &object_items() const;
     virtual const Json &operator[](const std::string &key) const;
+    virtual JsonNumberSpan packed_numbers() const;
 
     
     virtual ~JsonValue() {}
 };
 
+/**
+ * Read-only view of a value inside a binary snapshot.
+ * Views are two pointers wide, never allocate and stay valid as long as
+ * the snapshot memory they point into.
+ */
+class JsonSnapshotView final
+{
+public:
+    class ArrayRange;
+    class ObjectRange;
+
+    /**
+     * Accessors
+     */
+    Json::Type type() const;
+
+    bool is_null() const { return type() == Json::Type::NUL; }
+    bool is_number() const { return type() == Json::Type::NUMBER; }
+    bool is_bool() const { return type() == Json::Type::BOOL; }
+    bool is_string() const { return type() == Json::Type::STRING; }
+    bool is_array() const { return type() == Json::Type::ARRAY; }
+    bool is_object() const { return type() == Json::Type::OBJECT; }
+
+    double number_value() const;
+    int int_value() const;
+    bool bool_value() const;
+    JsonStringRef string_value() const;
+    ArrayRange array_items() const;
+    ObjectRange object_items() const;
+
+    // element or member count, 0 for scalars
+    size_t size() const;
+
+    JsonSnapshotView operator[](size_t i) const;
+    JsonSnapshotView operator[](const std::string &key) const;
+
+    /**
+     * Materialize as a Json DOM
+     */
+    Json to_json() const;
+
+    /**
+     * Serialize
+     */
+    void dump(std::string &out, const JsonFormat &format = JsonFormat()) const;
+    std::string dump(const JsonFormat &format = JsonFormat()) const
+    {
+        std::string out;
+        dump(out, format);
+        return out;
+    }
+
+private:
+    friend class JsonSnapshot;
+
+    JsonSnapshotView(const char *base, const uint64_t *rec) : m_base(base), m_rec(rec) {}
+    JsonSnapshotView at(uint64_t offset) const;
+
+    const char *m_base;
+    const uint64_t *m_rec;
+};
+
+class JsonSnapshotView::ArrayRange final
+{
+public:
+    class iterator
+    {
+    public:
+        iterator(const char *base, const uint64_t *pos) : m_base(base), m_pos(pos) {}
+        JsonSnapshotView operator*() const;
+        iterator &operator++()
+        {
+            ++m_pos;
+            return *this;
+        }
+        bool operator==(const iterator &rhs) const { return m_pos == rhs.m_pos; }
+        bool operator!=(const iterator &rhs) const { return m_pos != rhs.m_pos; }
+
+    private:
+        const char *m_base;
+        const uint64_t *m_pos;
+    };
+
+    ArrayRange(const char *base, const uint64_t *first, size_t count)
+        : m_base(base), m_first(first), m_count(count) {}
+
+    iterator begin() const { return iterator(m_base, m_first); }
+    iterator end() const { return iterator(m_base, m_first + m_count); }
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+    JsonSnapshotView operator[](size_t i) const { return *iterator(m_base, m_first + i); }
+
+private:
+    const char *m_base;
+    const uint64_t *m_first;
+    size_t m_count;
+};
+
+class JsonSnapshotView::ObjectRange final
+{
+public:
+    using value_type = std::pair<JsonStringRef, JsonSnapshotView>;
+
+    class iterator
+    {
+    public:
+        iterator(const char *base, const uint64_t *pos) : m_base(base), m_pos(pos) {}
+        value_type operator*() const;
+        iterator &operator++()
+        {
+            m_pos += 2;
+            return *this;
+        }
+        bool operator==(const iterator &rhs) const { return m_pos == rhs.m_pos; }
+        bool operator!=(const iterator &rhs) const { return m_pos != rhs.m_pos; }
+
+    private:
+        const char *m_base;
+        const uint64_t *m_pos;
+    };
+
+    ObjectRange(const char *base, const uint64_t *first, size_t count)
+        : m_base(base), m_first(first), m_count(count) {}
+
+    iterator begin() const { return iterator(m_base, m_first); }
+    iterator end() const { return iterator(m_base, m_first + 2 * m_count); }
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+private:
+    const char *m_base;
+    const uint64_t *m_first;
+    size_t m_count;
+};
+
+/**
+ * Binary snapshot written by Json::dump_snapshot.
+ * The format is position independent: open() maps the file read-only,
+ * so processes loading the same snapshot share its pages. Both open and
+ * from_buffer check every record once, so a truncated or corrupt file is
+ * rejected rather than read out of bounds; this touches every page.
+ */
+class JsonSnapshot final
+{
+public:
+    JsonSnapshot() noexcept;
+    ~JsonSnapshot();
+    JsonSnapshot(JsonSnapshot &&other) noexcept;
+    JsonSnapshot &operator=(JsonSnapshot &&other) noexcept;
+    JsonSnapshot(const JsonSnapshot &) = delete;
+    JsonSnapshot &operator=(const JsonSnapshot &) = delete;
+
+    // map a snapshot file
+    static JsonSnapshot open(const std::string &filename, std::string &err);
+    // wrap caller-owned memory, must be 8-byte aligned and outlive the snapshot
+    static JsonSnapshot from_buffer(const char *data, size_t size, std::string &err);
+
+    bool valid() const { return m_data != nullptr; }
+    const char *data() const { return m_data; }
+    size_t size() const { return m_size; }
+
+    JsonSnapshotView root() const;
+
+private:
+    void reset() noexcept;
+
+    const char *m_data;
+    size_t m_size;
+    void *m_map;
+    size_t m_map_size;
+    uint64_t *m_owned;
+};
+
+/**
+ * Read-only view of a value inside a JsonTape.
+ * Containers know where they end, so skipping a subtree is a single jump.
+ */
+class JsonTapeView final
+{
+public:
+    class ArrayRange;
+    class ObjectRange;
+
+    /**
+     * Accessors
+     */
+    Json::Type type() const;
+
+    bool is_null() const { return type() == Json::Type::NUL; }
+    bool is_number() const { return type() == Json::Type::NUMBER; }
+    bool is_bool() const { return type() == Json::Type::BOOL; }
+    bool is_string() const { return type() == Json::Type::STRING; }
+    bool is_array() const { return type() == Json::Type::ARRAY; }
+    bool is_object() const { return type() == Json::Type::OBJECT; }
+
+    double number_value() const;
+    int int_value() const;
+    bool bool_value() const;
+    JsonStringRef string_value() const;
+    ArrayRange array_items() const;
+    ObjectRange object_items() const;
+
+    // element or member count, 0 for scalars
+    size_t size() const;
+
+    // linear in the number of preceding siblings
+    JsonTapeView operator[](size_t i) const;
+    JsonTapeView operator[](const std::string &key) const;
+
+    /**
+     * Materialize as a Json DOM
+     */
+    Json to_json() const;
+
+    /**
+     * Serialize
+     */
+    void dump(std::string &out, const JsonFormat &format = JsonFormat()) const;
+    std::string dump(const JsonFormat &format = JsonFormat()) const
+    {
+        std::string out;
+        dump(out, format);
+        return out;
+    }
+
+private:
+    friend class JsonTape;
+
+    JsonTapeView(const uint64_t *tape, const char *strings, size_t index)
+        : m_tape(tape), m_strings(strings), m_index(index) {}
+
+    const uint64_t *m_tape;
+    const char *m_strings;
+    size_t m_index;
+};
+
+class JsonTapeView::ArrayRange final
+{
+public:
+    class iterator
+    {
+    public:
+        iterator(const uint64_t *tape, const char *strings, size_t index)
+            : m_tape(tape), m_strings(strings), m_index(index) {}
+        JsonTapeView operator*() const { return JsonTapeView(m_tape, m_strings, m_index); }
+        iterator &operator++();
+        bool operator==(const iterator &rhs) const { return m_index == rhs.m_index; }
+        bool operator!=(const iterator &rhs) const { return m_index != rhs.m_index; }
+
+    private:
+        const uint64_t *m_tape;
+        const char *m_strings;
+        size_t m_index;
+    };
+
+    ArrayRange(const uint64_t *tape, const char *strings, size_t first, size_t last, size_t count)
+        : m_tape(tape), m_strings(strings), m_first(first), m_last(last), m_count(count) {}
+
+    iterator begin() const { return iterator(m_tape, m_strings, m_first); }
+    iterator end() const { return iterator(m_tape, m_strings, m_last); }
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+private:
+    const uint64_t *m_tape;
+    const char *m_strings;
+    size_t m_first;
+    size_t m_last;
+    size_t m_count;
+};
+
+class JsonTapeView::ObjectRange final
+{
+public:
+    using value_type = std::pair<JsonStringRef, JsonTapeView>;
+
+    class iterator
+    {
+    public:
+        iterator(const uint64_t *tape, const char *strings, size_t index)
+            : m_tape(tape), m_strings(strings), m_index(index) {}
+        value_type operator*() const;
+        iterator &operator++();
+        bool operator==(const iterator &rhs) const { return m_index == rhs.m_index; }
+        bool operator!=(const iterator &rhs) const { return m_index != rhs.m_index; }
+
+    private:
+        const uint64_t *m_tape;
+        const char *m_strings;
+        size_t m_index;
+    };
+
+    ObjectRange(const uint64_t *tape, const char *strings, size_t first, size_t last, size_t count)
+        : m_tape(tape), m_strings(strings), m_first(first), m_last(last), m_count(count) {}
+
+    iterator begin() const { return iterator(m_tape, m_strings, m_first); }
+    iterator end() const { return iterator(m_tape, m_strings, m_last); }
+    size_t size() const { return m_count; }
+    bool empty() const { return m_count == 0; }
+
+private:
+    const uint64_t *m_tape;
+    const char *m_strings;
+    size_t m_first;
+    size_t m_last;
+    size_t m_count;
+};
+
+/**
+ * Flat read-only document.
+ * tape    : one 64-bit word per value (type in the top byte, inline scalar or
+ *           offset below it), doubles take a second word, containers store the
+ *           index just past their closing word
+ * strings : length-prefixed, '\0'-terminated string bytes
+ * Members keep document order, duplicate keys included. Lookup, to_json and
+ * a sort_keys dump see only the last of them, as Json::parse does; an
+ * unsorted dump writes them all.
+ */
+class JsonTape final
+{
+public:
+    /**
+     * Takes the strategy, max_depth and validate_utf8 from options; the
+     * tape has its own number and array layout, so the rest is ignored.
+     */
+    static JsonTape parse(const std::string &in,
+                          std::string &err,
+                          const JsonParseOptions &options);
+    static JsonTape parse(const std::string &in,
+                          std::string &err,
+                          JsonParse strategy = JsonParse::STANDARD)
+    {
+        JsonParseOptions options;
+        options.strategy = strategy;
+        return parse(in, err, options);
+    }
+
+    bool empty() const { return m_tape.empty(); }
+    JsonTapeView root() const;
+
+    const std::vector<uint64_t> &tape() const { return m_tape; }
+    const std::string &strings() const { return m_strings; }
+
+private:
+    std::vector<uint64_t> m_tape;
+    std::string m_strings;
+};
+
 }
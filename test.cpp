@@ -1,8 +1,31 @@
 #include "jsonL.hpp"
 #include <iostream>
+#include <fstream>
+#include <sstream>
+#include <cstdlib>
+#include <cstring>
+#include <new>
 using namespace jsonL;
 using namespace std;
 
+/**
+ * Count every global allocation, see "Allocation budget" in main
+ */
+static size_t alloc_count = 0;
+
+void *operator new(size_t size)
+{
+    alloc_count++;
+    if (void *p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept
+{
+    free(p);
+}
+
 void print_type(Json::Type t);
 
 class A{
@@ -110,6 +133,392 @@ int main(int argc, char const *argv[])
     }
 #endif
 
+/**
+ * Parse statistics, build with -DJSONL_PARSE_STATS=ON
+*/
+#if 0
+    string err;
+    JsonParseStats stats;
+    Json json = Json::parse("{\"name\": \"liu\\tshuai\", \"height\": 181.5}", err, JsonParse::STANDARD, &stats);
+    cout << stats.enabled << " strings " << stats.strings << " escapes " << stats.escapes
+         << " strtod " << stats.strtod_fallbacks << " nodes " << stats.nodes << endl;
+#endif
+
+/**
+ * Relaxed syntax: comments, trailing commas, single quotes, unquoted keys
+*/
+#if 0
+    string err;
+    Json json = Json::parse("{name: 'liu shuai', scores: [90, 85.5,], /* note */}", err, JsonParse::RELAXED);
+    cout << json.dump() << endl;
+#endif
+
+/**
+ * Parse options, nesting beyond the default 200 levels
+*/
+#if 0
+    string err;
+    JsonParseOptions options;
+    options.max_depth = 1000;
+    string deep = string(500, '[') + string(500, ']');
+    Json json = Json::parse(deep, err, options);
+    cout << "depth 500: " << (err.empty() ? "ok" : err) << endl;
+    Json::parse(deep, err);
+    cout << "default limit: " << err << endl;
+#endif
+
+/**
+ * UTF-8 validation of string contents
+*/
+#if 0
+    string err;
+    JsonParseOptions options;
+    options.validate_utf8 = true;
+    Json::parse("[\"liu\xc3\x28shuai\"]", err, options);
+    cout << "validating: " << err << endl;
+    err.clear();
+    Json json = Json::parse("[\"liu\xc3\x28shuai\"]", err);
+    cout << "default: " << (err.empty() ? "ok" : err) << endl;
+#endif
+
+/**
+ * Raw fragments, pre-serialized text embedded as is
+*/
+#if 0
+    string err;
+    Json cached = Json::raw("{\"id\":1,\"tags\":[\"a\",\"b\"]}");
+    Json json = Json::object{{"user", cached}, {"ok", true}};
+    cout << json.dump() << endl;
+    cout << json.dump(JsonFormat::pretty()) << endl;
+    Json bad = Json::raw("{\"id\":", err);
+    cout << bad.is_null() << " " << err << endl;
+    string snapshot;
+    cout << Json(Json::array{Json::raw("[1,")}).dump_snapshot(snapshot, err) << " " << err << endl;
+#endif
+
+/**
+ * Dump cache, a shared subtree is serialized once
+*/
+#if 0
+    string err;
+    Json config = Json::parse_from_file("config.json", err).cached();
+    for (int id = 0; id < 3; id++)
+        cout << Json(Json::object{{"id", id}, {"config", config}}).dump() << endl;
+    JsonDumpCacheStats stats = Json::dump_cache_stats();
+    cout << stats.nodes << " nodes, " << stats.bytes << " bytes" << endl;
+#endif
+
+/**
+ * Packed numbers, arrays of only numbers kept as doubles
+*/
+#if 0
+    string err;
+    JsonParseOptions options;
+    options.pack_numbers = true;
+    Json json = Json::parse("{\"point\": [116.39, 39.9], \"tags\": [1, \"a\"]}", err, options);
+    double sum = 0;
+    for (double value : json["point"].packed_numbers())
+        sum += value;
+    cout << json["point"].is_packed() << " " << json["tags"].is_packed() << " " << sum << endl;
+    cout << json["point"][1].number_value() << " " << json.dump() << endl;
+#endif
+
+/**
+ * Lazy numbers, the source text is kept and dumped as is
+*/
+#if 0
+    string err;
+    JsonParseOptions options;
+    options.lazy_numbers = true;
+    Json json = Json::parse("{\"price\": 19.90, \"rate\": 1E-3}", err, options);
+    cout << json.dump() << endl;
+    cout << json["price"].number_value() << endl;
+#endif
+
+/**
+ * Parse-time projection, only the listed paths are built
+*/
+#if 0
+    string err;
+    JsonProjection projection = {"statuses.*.user.id", "statuses.*.text"};
+    JsonParseOptions options;
+    options.projection = &projection;
+    Json json = Json::parse_from_file("twitter.json", err);
+    string in = json.dump();
+    Json slim = Json::parse(in, err, options);
+    cout << slim["statuses"][0].dump() << endl;
+#endif
+
+/**
+ * Validate without building the document
+*/
+#if 0
+    string err;
+    string in = "{\"name\": \"liu shuai\", \"scores\": [90, 85.5, [77]]}";
+    JsonValidateStats stats;
+    if (Json::validate(in.data(), in.size(), err, stats))
+        cout << "depth " << stats.max_depth << " arrays " << stats.arrays << " numbers " << stats.numbers << endl;
+    Json::validate(in.data(), in.size() - 1, err);
+    cout << err << endl;
+#endif
+
+/**
+ * Reformat text to text, keeping number spelling and member order
+*/
+#if 0
+    string err, out;
+    string in = "{\"name\": \"liu shuai\", \"height\": 1.815e2, \"age\": 25}";
+    Json::reformat(in.data(), in.size(), out, err);
+    cout << out << endl;
+    out.clear();
+    Json::reformat(in.data(), in.size(), out, err, JsonFormat::pretty(2));
+    cout << out << endl;
+#endif
+
+/**
+ * Kernel dispatch, or run with JSONL_KERNEL=scalar|sse42|avx2|avx512
+*/
+#if 0
+    cout << "kernel " << Json::kernel_name(Json::kernel()) << endl;
+    if (!Json::set_kernel(JsonKernel::AVX512))
+        cout << "no avx512 on this cpu" << endl;
+    Json::set_kernel(JsonKernel::SCALAR);
+    cout << "kernel " << Json::kernel_name(Json::kernel()) << endl;
+#endif
+
+/**
+ * Dump format
+*/
+#if 0
+    Json json = Json::object {{"name", "liu shuai"}, {"scores", Json::array {90, 85.5}}};
+    cout << json.dump() << endl;
+    cout << json.dump(JsonFormat::minified()) << endl;
+    cout << json.dump(JsonFormat::pretty(2)) << endl;
+#endif
+
+/**
+ * ASCII-only output
+*/
+#if 0
+    Json json = Json::object {{"name", "liu shuai \xe5\x88\x98\xe5\xb8\x85"}, {"mood", "\xf0\x9f\x98\x80"}};
+    JsonFormat format;
+    format.ascii_only = true;
+    cout << json.dump(format) << endl;
+#endif
+
+/**
+ * Binary snapshot
+*/
+#if 0
+    string err;
+    Json json = Json::parse_from_file("citm_catalog.json", err);
+    json.dump_snapshot_to_file("citm_catalog.snap", err);
+
+    JsonSnapshot snapshot = JsonSnapshot::open("citm_catalog.snap", err);
+    JsonSnapshotView root = snapshot.root();
+    print_type(root.type());
+    for (auto item : root["events"].object_items())
+        cout << item.first.str() << " " << item.second["name"].string_value().str() << endl;
+#endif
+
+/**
+ * Tape document
+*/
+#if 0
+    string err;
+    string in = "{\"name\": \"liu shuai\", \"scores\": [90, 85.5, 77]}";
+    JsonTape doc = JsonTape::parse(in, err);
+    JsonTapeView root = doc.root();
+    cout << root["name"].string_value().str() << endl;
+    for (auto score : root["scores"].array_items())
+        cout << score.number_value() << endl;
+#endif
+
+/**
+ * Allocation budget
+ * exact operator new calls made by Json::parse on each testdata file,
+ * update the table when a change intentionally moves the numbers
+*/
+#if 1
+    {
+        const struct
+        {
+            const char *file;
+            size_t budget;
+        } budgets[] = {
+            {"book.json", 65},
+            {"canada.json", 281381},
+            {"citm_catalog.json", 70396},
+            {"github_events.json", 2908},
+            {"gsoc-2018.json", 54460},
+            {"lottie.json", 88998},
+            {"poet.json", 79410},
+            {"twitter.json", 12344},
+            {"twitterescaped.json", 30620},
+        };
+
+        // first use sets up the library statics, keep that out of the budget
+        string warmup_err;
+        Json::parse("[null, true, false]", warmup_err);
+
+        bool within_budget = true;
+        for (const auto &item : budgets)
+        {
+            ifstream fin(string(JSONL_TESTDATA_DIR) + item.file);
+            stringstream buffer;
+            buffer << fin.rdbuf();
+            string in = buffer.str();
+
+            string err;
+            size_t before = alloc_count;
+            {
+                Json json = Json::parse(in, err);
+            }
+            size_t used = alloc_count - before;
+
+            cout << item.file << " allocations " << used << " budget " << item.budget << endl;
+            if (!err.empty() || used != item.budget)
+                within_budget = false;
+        }
+        if (!within_budget)
+        {
+            cout << "allocation budget mismatch" << endl;
+            return 1;
+        }
+    }
+#endif
+
+/**
+ * Parse paths agree
+ * every other way of reading a testdata file must give what Json::parse
+ * gives, and each path must reject what Json::parse rejects
+*/
+#if 1
+    {
+        const char *files[] = {"book.json", "canada.json", "citm_catalog.json", "github_events.json", "gsoc-2018.json",
+                               "lottie.json", "poet.json", "twitter.json", "twitterescaped.json"};
+
+        JsonProjection everything{"*"};
+        bool agree = true;
+        auto check = [&agree](const char *file, const char *path, bool ok) {
+            if (!ok)
+            {
+                cout << file << " " << path << " differs from Json::parse" << endl;
+                agree = false;
+            }
+        };
+        for (const char *file : files)
+        {
+            ifstream fin(string(JSONL_TESTDATA_DIR) + file);
+            stringstream buffer;
+            buffer << fin.rdbuf();
+            string in = buffer.str();
+
+            string err;
+            Json json = Json::parse(in, err);
+            check(file, "parse", err.empty());
+
+            JsonParseOptions options;
+            options.projection = &everything;
+            check(file, "projection", Json::parse(in, err, options) == json);
+            options = JsonParseOptions();
+            options.pack_numbers = true;
+            check(file, "pack_numbers", Json::parse(in, err, options) == json);
+            options = JsonParseOptions();
+            options.lazy_numbers = true;
+            check(file, "lazy_numbers", Json::parse(in, err, options) == json);
+            options = JsonParseOptions();
+            options.validate_utf8 = true;
+            check(file, "validate_utf8", Json::parse(in, err, options) == json);
+
+            check(file, "validate", Json::validate(in.data(), in.size(), err));
+            string minified, pretty;
+            check(file, "reformat", Json::reformat(in.data(), in.size(), minified, err) &&
+                                        Json::reformat(in.data(), in.size(), pretty, err, JsonFormat::pretty()) &&
+                                        Json::parse(minified, err) == json && Json::parse(pretty, err) == json);
+
+            string out;
+            check(file, "snapshot", json.dump_snapshot(out, err));
+            vector<uint64_t> aligned(out.size() / sizeof(uint64_t) + 1);
+            memcpy(aligned.data(), out.data(), out.size());
+            JsonSnapshot snapshot = JsonSnapshot::from_buffer(reinterpret_cast<const char *>(aligned.data()), out.size(), err);
+            check(file, "snapshot", snapshot.valid() && snapshot.root().to_json() == json);
+
+            JsonTape tape = JsonTape::parse(in, err);
+            check(file, "tape", !tape.empty() && tape.root().to_json() == json);
+        }
+
+        // duplicate keys: the last one wins on every path
+        {
+            const string duplicates = "{\"b\": 1, \"a\": [1], \"b\": {\"c\": 2, \"c\": 3}, \"a\": 4}";
+            string err;
+            Json json = Json::parse(duplicates, err);
+            JsonTape tape = JsonTape::parse(duplicates, err);
+            string tape_dump;
+            tape.root().dump(tape_dump);
+            check("duplicate keys", "tape", tape.root().to_json() == json && tape_dump == json.dump() &&
+                                              tape.root()["b"]["c"].int_value() == 3);
+            JsonParseOptions options;
+            options.projection = &everything;
+            check("duplicate keys", "projection", Json::parse(duplicates, err, options) == json);
+            string reformatted;
+            check("duplicate keys", "reformat", Json::reformat(duplicates.data(), duplicates.size(), reformatted, err) &&
+                                                  Json::parse(reformatted, err) == json);
+        }
+
+        // inputs every path has to refuse
+        JsonProjection only_a{"a"};
+        JsonParseOptions options;
+        options.projection = &only_a;
+        string err;
+        check("{\"a\":1,\"b\":[1-e+.}}", "projection", Json::parse("{\"a\":1,\"b\":[1-e+.}}", err, options).is_null() && !err.empty());
+        options = JsonParseOptions();
+        options.validate_utf8 = true;
+        const string surrogate = "[\"\\ud800\"]";
+        err.clear();
+        check(surrogate.c_str(), "validate_utf8", Json::parse(surrogate, err, options).is_null() && !err.empty());
+        err.clear();
+        check(surrogate.c_str(), "validate", !Json::validate(surrogate.data(), surrogate.size(), err, options));
+        err.clear();
+        check(surrogate.c_str(), "tape", JsonTape::parse(surrogate, err, options).empty());
+
+        // a skipped subtree nested deeper than validate's stack still skips
+        // within max_depth
+        const string deep = "{\"a\":1,\"b\":" + string(5000, '[') + string(5000, ']') + "}";
+        options = JsonParseOptions();
+        options.max_depth = 6000;
+        options.projection = &only_a;
+        err.clear();
+        check("5000 levels", "projection", Json::parse(deep, err, options) == Json(Json::object{{"a", 1}}) && err.empty());
+        options.max_depth = 4000;
+        check("5000 levels", "projection", Json::parse(deep, err, options).is_null() && !err.empty());
+
+        // raw text under ascii_only: copied when ASCII, \u escaped otherwise
+        JsonFormat ascii;
+        ascii.ascii_only = true;
+        check("[1, 5]", "raw ascii_only", Json(Json::array{Json::raw("1"), 5}).dump(ascii) == "[1, 5]");
+        check("[\"\xe5\x88\x98\"]", "raw ascii_only",
+              Json(Json::array{Json::raw("[\"\xe5\x88\x98 \\\"\"]"), 5}).dump(ascii) == "[[\"\\u5218 \\\"\"], 5]");
+
+        // relaxed \' in either quote style reformats to standard JSON
+        const string relaxed = "{'a': \"it\\'s\", b: 'it\\'s \"so\"'}";
+        JsonParseOptions relaxed_options;
+        relaxed_options.strategy = JsonParse::RELAXED;
+        string reformatted, strict_err;
+        err.clear();
+        check(relaxed.c_str(), "reformat",
+              Json::reformat(relaxed.data(), relaxed.size(), reformatted, err, JsonFormat::minified(), relaxed_options) &&
+                  Json::parse(reformatted, strict_err) == Json::parse(relaxed, err, JsonParse::RELAXED) &&
+                  strict_err.empty() && err.empty());
+
+        if (!agree)
+        {
+            cout << "parse path mismatch" << endl;
+            return 1;
+        }
+    }
+#endif
+
 /**
  * Implicit Ctors
 */
@@ -137,6 +546,7 @@ void print_type(Json::Type type_t)
         COUT(STRING);
         COUT(ARRAY);
         COUT(OBJECT);
+        COUT(RAW);
 #undef COUT
     default:
         break;